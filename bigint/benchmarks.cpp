@@ -0,0 +1,76 @@
+#include "big_integer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::mt19937 rng(12345);
+
+big_integer random_bits(size_t bits) {
+  big_integer res;
+  for (size_t i = 0; i < bits; i += 32) {
+    res <<= 32;
+    res += (unsigned) rng();
+  }
+  return res >> (int) ((32 - bits % 32) % 32);
+}
+
+// average time of f() in microseconds, repeated until it ran for a while
+template <typename F>
+double measure(F&& f) {
+  using clock = std::chrono::steady_clock;
+  size_t runs = 0;
+  auto start = clock::now();
+  auto elapsed = clock::duration::zero();
+  do {
+    f();
+    runs++;
+    elapsed = clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(200));
+  return std::chrono::duration<double, std::micro>(elapsed).count() / runs;
+}
+
+// products of two residues modulo the same modulus, timed inside a
+// scratch_scope as a loop of reductions would be
+void bench_reduction(size_t bits) {
+  scratch_scope scope;
+  big_integer m = random_bits(bits);
+  std::vector<big_integer> products;
+  for (int i = 0; i < 16; i++) {
+    products.push_back(random_bits(bits - 1) * random_bits(bits - 1));
+  }
+  big_reciprocal rec = m.reciprocal();
+  barrett_reducer red(m);
+
+  big_integer sink;
+  double t_div = measure([&] {
+    for (big_integer const& x : products) {
+      sink = x % m;
+    }
+  });
+  double t_rec = measure([&] {
+    for (big_integer const& x : products) {
+      sink = x % rec;
+    }
+  });
+  double t_barrett = measure([&] {
+    for (big_integer const& x : products) {
+      sink = x % red;
+    }
+  });
+  size_t k = products.size();
+  std::printf("%8zu %14.3f %14.3f %14.3f\n", bits, t_div / k, t_rec / k, t_barrett / k);
+}
+
+} // namespace
+
+int main() {
+  std::printf("reduction of a product below m^2, microseconds\n");
+  std::printf("%8s %14s %14s %14s\n", "bits", "operator%", "reciprocal", "barrett");
+  for (size_t bits : {256, 1024, 2048, 4096, 8192, 16384, 65536, 262144}) {
+    bench_reduction(bits);
+  }
+}
@@ -1,12 +1,220 @@
 #include "big_integer.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cmath>
 #include <cstddef>
 #include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
 #include <ostream>
 #include <stdexcept>
-
-static const int64_t BASE = UINT32_MAX + 1ULL;
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// double limb for intermediate products and carries, BASE = 2^LIMB_BITS
+
+#ifdef BIGINT_LIMB64
+__extension__ typedef unsigned __int128 dlimb_t;
+__extension__ typedef __int128 sdlimb_t;
+#else
+typedef uint64_t dlimb_t;
+typedef int64_t sdlimb_t;
+#endif
+
+static const int LIMB_BITS = 8 * sizeof(limb_t);
+static const limb_t LIMB_MAX = ~(limb_t) 0;
 static const uint32_t DIGIT_BASE = 1000000000;
 
+// inside a scratch_scope heap buffers of limb_vector get power-of-two
+// capacities, so a released one can serve any later request of the same size
+// class: they are kept in a free list per class, linked through their first
+// bytes, and only go back to the heap when the outermost scope on the thread
+// ends. Outside a scope capacities are exact
+
+namespace {
+
+struct limb_cache {
+  limb_t* free[64];
+  size_t depth;
+};
+
+thread_local limb_cache cache;
+
+size_t size_class(size_t n) {
+  size_t c = 0;
+  while (((size_t) 1 << c) < n) {
+    c++;
+  }
+  return c;
+}
+
+// rounds n up to the capacity it gets
+limb_t* allocate_limbs(size_t& n) {
+  if (cache.depth == 0) {
+    return new limb_t[n];
+  }
+  size_t c = size_class(n);
+  n = (size_t) 1 << c;
+  limb_t* p = cache.free[c];
+  if (p == nullptr) {
+    return new limb_t[n];
+  }
+  std::memcpy(&cache.free[c], p, sizeof(p));
+  return p;
+}
+
+void free_limbs(limb_t* p, size_t n) {
+  size_t c = size_class(n);
+  if (cache.depth == 0 || n != (size_t) 1 << c) {
+    delete[] p;
+    return;
+  }
+  std::memcpy(p, &cache.free[c], sizeof(p));
+  cache.free[c] = p;
+}
+
+} // namespace
+
+scratch_scope::scratch_scope() {
+  cache.depth++;
+}
+
+scratch_scope::~scratch_scope() {
+  if (--cache.depth != 0) {
+    return;
+  }
+  for (limb_t*& head : cache.free) {
+    while (head != nullptr) {
+      limb_t* p = head;
+      std::memcpy(&head, p, sizeof(p));
+      delete[] p;
+    }
+  }
+}
+
+limb_vector::limb_vector(size_t n) : limb_vector() {
+  resize(n);
+}
+
+limb_vector::limb_vector(limb_vector const& other) : limb_vector() {
+  assign(other.begin(), other.end());
+}
+
+limb_vector::limb_vector(limb_vector&& other) noexcept : limb_vector() {
+  steal(other);
+}
+
+limb_vector::~limb_vector() {
+  if (capacity_ > INLINE_CAPACITY) {
+    free_limbs(heap_, capacity_);
+  }
+}
+
+limb_vector& limb_vector::operator=(limb_vector const& other) {
+  if (&other != this) {
+    assign(other.begin(), other.end());
+  }
+  return *this;
+}
+
+limb_vector& limb_vector::operator=(limb_vector&& other) noexcept {
+  if (&other != this) {
+    if (capacity_ > INLINE_CAPACITY) {
+      free_limbs(heap_, capacity_);
+    }
+    steal(other);
+  }
+  return *this;
+}
+
+void limb_vector::steal(limb_vector& other) noexcept {
+  size_ = other.size_;
+  capacity_ = other.capacity_;
+  if (capacity_ > INLINE_CAPACITY) {
+    heap_ = other.heap_;
+  } else {
+    std::copy(other.inline_, other.inline_ + size_, inline_);
+  }
+  other.size_ = 0;
+  other.capacity_ = INLINE_CAPACITY;
+}
+
+void limb_vector::grow(size_t n) {
+  limb_t* p = allocate_limbs(n);
+  std::copy(begin(), end(), p);
+  if (capacity_ > INLINE_CAPACITY) {
+    free_limbs(heap_, capacity_);
+  }
+  heap_ = p;
+  capacity_ = n;
+}
+
+void limb_vector::reserve(size_t n) {
+  if (n > capacity_) {
+    grow(n);
+  }
+}
+
+void limb_vector::resize(size_t n) {
+  if (n > capacity_) {
+    grow(std::max(n, 2 * capacity_));
+  }
+  if (n > size_) {
+    std::fill(data() + size_, data() + n, 0);
+  }
+  size_ = n;
+}
+
+void limb_vector::assign(size_t n, limb_t value) {
+  size_ = 0;
+  reserve(n);
+  std::fill(data(), data() + n, value);
+  size_ = n;
+}
+
+void limb_vector::assign(limb_t const* first, limb_t const* last) {
+  size_t n = last - first;
+  size_ = 0;
+  reserve(n);
+  std::copy(first, last, data());
+  size_ = n;
+}
+
+limb_t* limb_vector::insert(limb_t* pos, size_t count, limb_t value) {
+  size_t i = pos - data();
+  if (size_ + count > capacity_) {
+    grow(std::max(size_ + count, 2 * capacity_));
+  }
+  limb_t* p = data();
+  std::copy_backward(p + i, p + size_, p + size_ + count);
+  std::fill(p + i, p + i + count, value);
+  size_ += count;
+  return p + i;
+}
+
+limb_t* limb_vector::insert(limb_t* pos, limb_t value) {
+  return insert(pos, 1, value);
+}
+
+limb_t* limb_vector::erase(limb_t* pos) {
+  std::copy(pos + 1, end(), pos);
+  size_--;
+  return pos;
+}
+
+bool operator==(limb_vector const& a, limb_vector const& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
 bool big_integer::is_zero() const {
   return (this->number.empty());
 }
@@ -17,21 +225,23 @@ big_integer::big_integer() :
 
 big_integer::big_integer(big_integer const& other) = default;
 
+big_integer::big_integer(big_integer&& other) noexcept :
+      sign(other.sign), number(std::move(other.number)) {
+  other.sign = false;
+  other.number.clear();
+}
+
 void big_integer::fill_vector(uint64_t a) {
-  int i = 0;
-  while (a > 0) {
-    number[i] = a % BASE;
-    a /= (uint64_t) BASE;
-    i++;
+  for (; a > 0; a = (uint64_t) ((dlimb_t) a >> LIMB_BITS)) {
+    number.push_back((limb_t) a);
   }
-  cut_leading_zero(*this);
 }
 
-big_integer::big_integer(int a) : sign(a < 0), number(2) {
+big_integer::big_integer(int a) : sign(a < 0) {
   fill_vector(std::abs((int64_t)a));
 }
 
-big_integer::big_integer(unsigned a) : sign(false), number(2) {
+big_integer::big_integer(unsigned a) : sign(false) {
   fill_vector(a);
 }
 
@@ -41,7 +251,7 @@ big_integer::big_integer(long a) :
 big_integer::big_integer(unsigned long a) :
       big_integer(static_cast<unsigned long long>(a)) {}
 
-big_integer::big_integer(long long a) : sign(a < 0), number(3) {
+big_integer::big_integer(long long a) : sign(a < 0) {
   if (a == INT64_MIN) {
     fill_vector((uint64_t)(INT64_MAX + 1ULL));
   } else {
@@ -49,75 +259,1340 @@ big_integer::big_integer(long long a) : sign(a < 0), number(3) {
   }
 }
 
-big_integer::big_integer(unsigned long long a) : sign(false), number(3) {
-  fill_vector(a);
+big_integer::big_integer(unsigned long long a) : sign(false) {
+  fill_vector(a);
+}
+
+// DIGIT_BASE^(2^k) up to this level are cached per thread, about 30 KB
+
+static const size_t DECIMAL_POWER_CACHE_LEVEL = 12;
+
+// DIGIT_BASE^(2^k) for one conversion: the larger levels are squared on first
+// use and freed with the table, which costs less than the divisions by them.
+// An empty table allocates nothing; once used, large has room for every
+// level, so the references handed out stay valid while it grows
+
+struct big_integer::decimal_powers {
+  std::vector<big_integer> large;
+
+  big_integer const& operator[](size_t k) {
+    thread_local std::deque<big_integer> cached;
+    if (cached.empty()) {
+      cached.emplace_back(DIGIT_BASE);
+    }
+    while (cached.size() <= std::min(k, DECIMAL_POWER_CACHE_LEVEL)) {
+      cached.push_back(sqr(cached.back()));
+    }
+    if (k <= DECIMAL_POWER_CACHE_LEVEL) {
+      return cached[k];
+    }
+    large.reserve(8 * sizeof(size_t) - DECIMAL_POWER_CACHE_LEVEL);
+    while (DECIMAL_POWER_CACHE_LEVEL + large.size() < k) {
+      large.push_back(sqr(large.empty() ? cached.back() : large.back()));
+    }
+    return large[k - DECIMAL_POWER_CACHE_LEVEL - 1];
+  }
+};
+
+big_integer::big_integer(const std::string& str) : big_integer() {
+  std::string_view digits = str;
+  bool is_neg = !digits.empty() && digits[0] == '-';
+  if (is_neg) {
+    digits.remove_prefix(1);
+  }
+  if (digits.empty()) {
+    throw std::invalid_argument("Invalid number");
+  }
+  for (char c : digits) {
+    if (!('0' <= c && c <= '9')) {
+      throw std::invalid_argument("Invalid number");
+    }
+  }
+  size_t k = 0;
+  while (9 * ((size_t) 1 << k) < digits.size()) {
+    k++;
+  }
+  decimal_powers powers;
+  parse_decimal(digits, k, powers).swap(*this);
+  this->sign = is_neg && !is_zero();
+}
+
+big_integer::~big_integer() = default;
+
+void big_integer::swap(big_integer& a) {
+  std::swap(number, a.number);
+  std::swap(sign, a.sign);
+}
+
+big_integer& big_integer::operator=(big_integer const& other) {
+  if (&other != this) {
+    // keeps the current buffer when it is large enough
+    number = other.number;
+    sign = other.sign;
+  }
+  return *this;
+}
+
+big_integer& big_integer::operator=(big_integer&& other) noexcept {
+  if (&other != this) {
+    number = std::move(other.number);
+    sign = other.sign;
+    other.sign = false;
+    other.number.clear();
+  }
+  return *this;
+}
+
+void big_integer::cut_leading_zero(big_integer& num) {
+  size_t i = num.number.size();
+  while (i > 0 && num.number[i - 1] == 0) {
+    num.number.pop_back();
+    i--;
+  }
+}
+
+namespace {
+
+// limb kernels, all lengths are in limbs and numbers are little-endian
+
+// r[0..n) = a + b + carry, returns the carry out; r may alias a or b
+
+limb_t add_n_scalar(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t carry) {
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t cur = (dlimb_t) a[i] + b[i] + carry;
+    r[i] = (limb_t) cur;
+    carry = (limb_t) (cur >> LIMB_BITS);
+  }
+  return carry;
+}
+
+// r[0..n) = a - b - borrow, returns the borrow out; r may alias a or b
+
+limb_t sub_n_scalar(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t borrow) {
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t cur = (dlimb_t) a[i] - b[i] - borrow;
+    r[i] = (limb_t) cur;
+    borrow = (limb_t) (cur >> LIMB_BITS) & 1;
+  }
+  return borrow;
+}
+
+// r[0..n) = a << bits, returns the bits shifted out; 0 < bits < LIMB_BITS,
+// runs from the top so that r >= a may overlap
+
+limb_t lshift_scalar(limb_t* r, limb_t const* a, size_t n, int bits) {
+  limb_t out = a[n - 1] >> (LIMB_BITS - bits);
+  for (size_t i = n - 1; i > 0; i--) {
+    r[i] = (a[i] << bits) | (a[i - 1] >> (LIMB_BITS - bits));
+  }
+  r[0] = a[0] << bits;
+  return out;
+}
+
+// r[0..n) = a >> bits, returns the bits shifted out at the top of a limb;
+// 0 < bits < LIMB_BITS, runs from the bottom so that r <= a may overlap
+
+limb_t rshift_scalar(limb_t* r, limb_t const* a, size_t n, int bits) {
+  limb_t out = a[0] << (LIMB_BITS - bits);
+  for (size_t i = 0; i + 1 < n; i++) {
+    r[i] = (a[i] >> bits) | (a[i + 1] << (LIMB_BITS - bits));
+  }
+  r[n - 1] = a[n - 1] >> bits;
+  return out;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+// SIMD versions add all lanes of a vector at once and then resolve the
+// carries between lanes with scalar arithmetic on bit masks: g marks the
+// lanes that overflowed, p the lanes equal to all ones that pass an incoming
+// carry on. In ((g << 1) | carry) + p the carries ripple through p exactly
+// like through the lanes, so the lanes receiving a carry are the bits that
+// differ from p, and the bit past the last lane is the carry out.
+
+uint32_t carry_lanes(uint32_t g, uint32_t p, limb_t& carry, int lanes) {
+  uint32_t x = ((g << 1) | carry) + p;
+  carry = (x >> lanes) & 1;
+  return (x ^ p) & ((1u << lanes) - 1);
+}
+
+#ifdef BIGINT_LIMB64
+#define SIMD_EPI(op) op##epi64
+#define SIMD_EPI_MASK(op) op##epi64_mask
+#define SIMD_EPU_MASK(op) op##epu64_mask
+#define SIMD_SET1_256 _mm256_set1_epi64x
+#else
+#define SIMD_EPI(op) op##epi32
+#define SIMD_EPI_MASK(op) op##epi32_mask
+#define SIMD_EPU_MASK(op) op##epu32_mask
+#define SIMD_SET1_256 _mm256_set1_epi32
+#endif
+
+__attribute__((target("avx512f")))
+limb_t add_n_avx512(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t carry) {
+  constexpr int LANES = 64 / sizeof(limb_t);
+  __m512i const ones = SIMD_EPI(_mm512_set1_)(-1);
+  __m512i const one = SIMD_EPI(_mm512_set1_)(1);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    __m512i x = _mm512_loadu_si512(a + i);
+    __m512i s = SIMD_EPI(_mm512_add_)(x, _mm512_loadu_si512(b + i));
+    uint32_t g = SIMD_EPU_MASK(_mm512_cmplt_)(s, x);
+    uint32_t p = SIMD_EPI_MASK(_mm512_cmpeq_)(s, ones);
+    uint32_t in = carry_lanes(g, p, carry, LANES);
+    s = SIMD_EPI(_mm512_mask_add_)(s, in, s, one);
+    _mm512_storeu_si512(r + i, s);
+  }
+  return add_n_scalar(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx512f")))
+limb_t sub_n_avx512(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t borrow) {
+  constexpr int LANES = 64 / sizeof(limb_t);
+  __m512i const zero = _mm512_setzero_si512();
+  __m512i const one = SIMD_EPI(_mm512_set1_)(1);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    __m512i x = _mm512_loadu_si512(a + i);
+    __m512i y = _mm512_loadu_si512(b + i);
+    __m512i d = SIMD_EPI(_mm512_sub_)(x, y);
+    uint32_t g = SIMD_EPU_MASK(_mm512_cmplt_)(x, y);
+    uint32_t p = SIMD_EPI_MASK(_mm512_cmpeq_)(d, zero);
+    uint32_t in = carry_lanes(g, p, borrow, LANES);
+    d = SIMD_EPI(_mm512_mask_sub_)(d, in, d, one);
+    _mm512_storeu_si512(r + i, d);
+  }
+  return sub_n_scalar(r + i, a + i, b + i, n - i, borrow);
+}
+
+// AVX2 has neither unsigned comparisons nor mask registers: operands are
+// compared with their top bits flipped, lane masks are read with movemask
+// and expanded back into all-ones lanes, which are subtracted to add one
+
+__attribute__((target("avx2")))
+uint32_t movemask_avx2(__m256i x) {
+#ifdef BIGINT_LIMB64
+  return _mm256_movemask_pd(_mm256_castsi256_pd(x));
+#else
+  return _mm256_movemask_ps(_mm256_castsi256_ps(x));
+#endif
+}
+
+__attribute__((target("avx2")))
+__m256i expand_mask_avx2(uint32_t mask) {
+#ifdef BIGINT_LIMB64
+  __m256i bits = _mm256_setr_epi64x(1, 2, 4, 8);
+#else
+  __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+#endif
+  __m256i m = SIMD_SET1_256(mask);
+  return SIMD_EPI(_mm256_cmpeq_)(_mm256_and_si256(m, bits), bits);
+}
+
+__attribute__((target("avx2")))
+limb_t add_n_avx2(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t carry) {
+  constexpr int LANES = 32 / sizeof(limb_t);
+  __m256i const top = SIMD_SET1_256((limb_t) 1 << (LIMB_BITS - 1));
+  __m256i const ones = SIMD_SET1_256(-1);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    __m256i x = _mm256_loadu_si256((__m256i const*) (a + i));
+    __m256i s = SIMD_EPI(_mm256_add_)(x, _mm256_loadu_si256((__m256i const*) (b + i)));
+    __m256i lt = SIMD_EPI(_mm256_cmpgt_)(_mm256_xor_si256(x, top), _mm256_xor_si256(s, top));
+    uint32_t g = movemask_avx2(lt);
+    uint32_t p = movemask_avx2(SIMD_EPI(_mm256_cmpeq_)(s, ones));
+    uint32_t in = carry_lanes(g, p, carry, LANES);
+    s = SIMD_EPI(_mm256_sub_)(s, expand_mask_avx2(in));
+    _mm256_storeu_si256((__m256i*) (r + i), s);
+  }
+  return add_n_scalar(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+limb_t sub_n_avx2(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t borrow) {
+  constexpr int LANES = 32 / sizeof(limb_t);
+  __m256i const top = SIMD_SET1_256((limb_t) 1 << (LIMB_BITS - 1));
+  __m256i const zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    __m256i x = _mm256_loadu_si256((__m256i const*) (a + i));
+    __m256i y = _mm256_loadu_si256((__m256i const*) (b + i));
+    __m256i d = SIMD_EPI(_mm256_sub_)(x, y);
+    __m256i lt = SIMD_EPI(_mm256_cmpgt_)(_mm256_xor_si256(y, top), _mm256_xor_si256(x, top));
+    uint32_t g = movemask_avx2(lt);
+    uint32_t p = movemask_avx2(SIMD_EPI(_mm256_cmpeq_)(d, zero));
+    uint32_t in = carry_lanes(g, p, borrow, LANES);
+    d = SIMD_EPI(_mm256_add_)(d, expand_mask_avx2(in));
+    _mm256_storeu_si256((__m256i*) (r + i), d);
+  }
+  return sub_n_scalar(r + i, a + i, b + i, n - i, borrow);
+}
+
+// shifts combine two overlapping unaligned loads, offset by one limb; the
+// AVX-512 ones use the zero-masked forms, whose unmasked versions trip
+// -Wmaybe-uninitialized in some GCC headers
+
+__attribute__((target("avx512f")))
+limb_t lshift_avx512(limb_t* r, limb_t const* a, size_t n, int bits) {
+  constexpr size_t LANES = 64 / sizeof(limb_t);
+  limb_t out = a[n - 1] >> (LIMB_BITS - bits);
+  __m128i const left = _mm_cvtsi32_si128(bits);
+  __m128i const right = _mm_cvtsi32_si128(LIMB_BITS - bits);
+  size_t i = n;
+  while (i > LANES) {
+    i -= LANES;
+    __m512i hi = _mm512_loadu_si512(a + i);
+    __m512i lo = _mm512_loadu_si512(a + i - 1);
+    _mm512_storeu_si512(r + i, _mm512_or_si512(SIMD_EPI(_mm512_maskz_sll_)(-1, hi, left),
+                                               SIMD_EPI(_mm512_maskz_srl_)(-1, lo, right)));
+  }
+  lshift_scalar(r, a, i, bits);
+  return out;
+}
+
+__attribute__((target("avx512f")))
+limb_t rshift_avx512(limb_t* r, limb_t const* a, size_t n, int bits) {
+  constexpr size_t LANES = 64 / sizeof(limb_t);
+  limb_t out = a[0] << (LIMB_BITS - bits);
+  __m128i const right = _mm_cvtsi32_si128(bits);
+  __m128i const left = _mm_cvtsi32_si128(LIMB_BITS - bits);
+  size_t i = 0;
+  for (; i + LANES < n; i += LANES) {
+    __m512i lo = _mm512_loadu_si512(a + i);
+    __m512i hi = _mm512_loadu_si512(a + i + 1);
+    _mm512_storeu_si512(r + i, _mm512_or_si512(SIMD_EPI(_mm512_maskz_srl_)(-1, lo, right),
+                                               SIMD_EPI(_mm512_maskz_sll_)(-1, hi, left)));
+  }
+  rshift_scalar(r + i, a + i, n - i, bits);
+  return out;
+}
+
+__attribute__((target("avx2")))
+limb_t lshift_avx2(limb_t* r, limb_t const* a, size_t n, int bits) {
+  constexpr size_t LANES = 32 / sizeof(limb_t);
+  limb_t out = a[n - 1] >> (LIMB_BITS - bits);
+  __m128i const left = _mm_cvtsi32_si128(bits);
+  __m128i const right = _mm_cvtsi32_si128(LIMB_BITS - bits);
+  size_t i = n;
+  while (i > LANES) {
+    i -= LANES;
+    __m256i hi = _mm256_loadu_si256((__m256i const*) (a + i));
+    __m256i lo = _mm256_loadu_si256((__m256i const*) (a + i - 1));
+    _mm256_storeu_si256((__m256i*) (r + i), _mm256_or_si256(SIMD_EPI(_mm256_sll_)(hi, left),
+                                                           SIMD_EPI(_mm256_srl_)(lo, right)));
+  }
+  lshift_scalar(r, a, i, bits);
+  return out;
+}
+
+__attribute__((target("avx2")))
+limb_t rshift_avx2(limb_t* r, limb_t const* a, size_t n, int bits) {
+  constexpr size_t LANES = 32 / sizeof(limb_t);
+  limb_t out = a[0] << (LIMB_BITS - bits);
+  __m128i const right = _mm_cvtsi32_si128(bits);
+  __m128i const left = _mm_cvtsi32_si128(LIMB_BITS - bits);
+  size_t i = 0;
+  for (; i + LANES < n; i += LANES) {
+    __m256i lo = _mm256_loadu_si256((__m256i const*) (a + i));
+    __m256i hi = _mm256_loadu_si256((__m256i const*) (a + i + 1));
+    _mm256_storeu_si256((__m256i*) (r + i), _mm256_or_si256(SIMD_EPI(_mm256_srl_)(lo, right),
+                                                           SIMD_EPI(_mm256_sll_)(hi, left)));
+  }
+  rshift_scalar(r + i, a + i, n - i, bits);
+  return out;
+}
+
+#undef SIMD_EPI
+#undef SIMD_EPI_MASK
+#undef SIMD_EPU_MASK
+#undef SIMD_SET1_256
+
+#endif
+
+// the kernels the CPU supports, listed once on the first call, slowest first
+
+struct supported_kernels {
+  limb_kernels list[3];
+  size_t count;
+};
+
+supported_kernels select_kernels() {
+  supported_kernels res = {};
+  res.list[res.count++] = {"scalar", add_n_scalar, sub_n_scalar, lshift_scalar, rshift_scalar};
+#if defined(__GNUC__) && defined(__x86_64__)
+  if (__builtin_cpu_supports("avx2")) {
+    res.list[res.count++] = {"avx2", add_n_avx2, sub_n_avx2, lshift_avx2, rshift_avx2};
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    res.list[res.count++] = {"avx512", add_n_avx512, sub_n_avx512, lshift_avx512, rshift_avx512};
+  }
+#endif
+  return res;
+}
+
+supported_kernels const& all_kernels() {
+  static supported_kernels const res = select_kernels();
+  return res;
+}
+
+limb_kernels const& kernels() {
+  return all_kernels().list[all_kernels().count - 1];
+}
+
+// r = a + b, returns the carry; requires an >= bn, r may alias a or b
+
+limb_t add_limbs(limb_t* r, limb_t const* a, size_t an,
+                 limb_t const* b, size_t bn) {
+  limb_t carry = kernels().add_n(r, a, b, bn, 0);
+  size_t i = bn;
+  for (; i < an && carry != 0; i++) {
+    r[i] = a[i] + 1;
+    carry = (r[i] == 0);
+  }
+  if (r != a) {
+    std::copy(a + i, a + an, r + i);
+  }
+  return carry;
+}
+
+// r = a - b, returns the borrow; requires an >= bn, r may alias a or b
+
+limb_t sub_limbs(limb_t* r, limb_t const* a, size_t an,
+                 limb_t const* b, size_t bn) {
+  limb_t borrow = kernels().sub_n(r, a, b, bn, 0);
+  size_t i = bn;
+  for (; i < an && borrow != 0; i++) {
+    borrow = (a[i] == 0);
+    r[i] = a[i] - 1;
+  }
+  if (r != a) {
+    std::copy(a + i, a + an, r + i);
+  }
+  return borrow;
+}
+
+limb_t lshift_limbs(limb_t* r, limb_t const* a, size_t n, int bits) {
+  return kernels().lshift(r, a, n, bits);
+}
+
+limb_t rshift_limbs(limb_t* r, limb_t const* a, size_t n, int bits) {
+  return kernels().rshift(r, a, n, bits);
+}
+
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t m) {
+  limb_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t cur = (dlimb_t) a[i] * m + carry;
+    r[i] = (limb_t) cur;
+    carry = (limb_t) (cur >> LIMB_BITS);
+  }
+  return carry;
+}
+
+// r[0..n) -= a[0..n) * m, returns what is still to be taken from r[n]
+
+limb_t submul_1(limb_t* r, limb_t const* a, size_t n, limb_t m) {
+  limb_t borrow = 0;
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t cur = (dlimb_t) a[i] * m + borrow;
+    limb_t low = (limb_t) cur;
+    borrow = (limb_t) (cur >> LIMB_BITS) + (r[i] < low);
+    r[i] -= low;
+  }
+  return borrow;
+}
+
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t m) {
+  limb_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t cur = (dlimb_t) a[i] * m + r[i] + carry;
+    r[i] = (limb_t) cur;
+    carry = (limb_t) (cur >> LIMB_BITS);
+  }
+  return carry;
+}
+
+// r[0..an + bn) = a * b, r must not overlap a or b
+
+void mul_basecase(limb_t* r, limb_t const* a, size_t an,
+                  limb_t const* b, size_t bn) {
+  r[an] = mul_1(r, a, an, b[0]);
+  for (size_t j = 1; j < bn; j++) {
+    r[an + j] = addmul_1(r + j, a, an, b[j]);
+  }
+}
+
+// r[0..n) = a * b mod BASE^n, r must not overlap a or b; the rows of the
+// schoolbook product are cut at n limbs
+void mul_low_basecase(limb_t* r, limb_t const* a, size_t an,
+                      limb_t const* b, size_t bn, size_t n) {
+  std::fill(r, r + n, 0);
+  for (size_t j = 0; j < bn && j < n; j++) {
+    size_t len = std::min(an, n - j);
+    limb_t carry = addmul_1(r + j, a, len, b[j]);
+    if (j + len < n) {
+      r[j + len] = carry;
+    }
+  }
+}
+
+// r[0..an + bn - k) = the columns from k up of the schoolbook product a b,
+// the ones below k are skipped, which leaves r below a b / BASE^k by less
+// than k BASE
+void mul_high_basecase(limb_t* r, limb_t const* a, size_t an,
+                       limb_t const* b, size_t bn, size_t k) {
+  std::fill(r, r + an + bn - k, 0);
+  for (size_t j = 0; j < bn; j++) {
+    size_t i = (j < k ? k - j : 0);
+    if (i < an) {
+      r[j + an - k] = addmul_1(r + (i + j - k), a + i, an - i, b[j]);
+    }
+  }
+}
+
+// inverse of an odd d modulo 2^64, so also modulo BASE: every Newton step
+// doubles the number of correct low bits, starting from 3
+
+uint64_t limb_inverse(uint64_t d) {
+  uint64_t inv = d;
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - d * inv;
+  }
+  return inv;
+}
+
+// a is known to be divisible by d: multiplies by the inverse of the odd
+// part of d modulo BASE instead of dividing
+
+void divexact_1(limb_t* r, limb_t const* a, size_t n, limb_t d) {
+  if (n == 0) {
+    return;
+  }
+  int shift = 0;
+  while (d % 2 == 0) {
+    d /= 2;
+    shift++;
+  }
+  limb_t inv = (limb_t) limb_inverse(d);
+  limb_t borrow = 0;
+  limb_t prev = a[0];
+  for (size_t i = 0; i < n; i++) {
+    limb_t next = (i + 1 < n ? a[i + 1] : 0);
+    limb_t cur = (shift == 0 ? prev : (prev >> shift) | (next << (LIMB_BITS - shift)));
+    prev = next;
+    limb_t low = cur - borrow;
+    limb_t q = low * inv;
+    r[i] = q;
+    borrow = (limb_t) (((dlimb_t) q * d) >> LIMB_BITS) + (cur < borrow);
+  }
+}
+
+// a[0..n) /= d in place, returns the remainder; the limbs are taken in
+// 32-bit halves so that the compiler turns the division by a constant
+// d into a multiplication in both limb sizes
+
+uint32_t divrem_small(limb_t* a, size_t n, uint32_t d) {
+  uint64_t rem = 0;
+  for (size_t i = n; i > 0; i--) {
+    limb_t q = 0;
+    for (int s = LIMB_BITS - 32; s >= 0; s -= 32) {
+      uint64_t cur = (rem << 32) | (uint32_t) (a[i - 1] >> s);
+      q |= (limb_t) (cur / d) << s;
+      rem = cur % d;
+    }
+    a[i - 1] = q;
+  }
+  return (uint32_t) rem;
+}
+
+size_t normalized_size(limb_t const* a, size_t n) {
+  while (n > 0 && a[n - 1] == 0) {
+    n--;
+  }
+  return n;
+}
+
+int cmp_limbs(limb_t const* a, size_t an, limb_t const* b, size_t bn) {
+  if (an != bn) {
+    return an < bn ? -1 : 1;
+  }
+  for (size_t i = an; i > 0; i--) {
+    if (a[i - 1] != b[i - 1]) {
+      return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// number of limbs of a - b for a >= b, without storing the difference
+size_t difference_size(limb_t const* a, size_t an, limb_t const* b, size_t bn) {
+  size_t size = 0;
+  limb_t borrow = 0;
+  for (size_t i = 0; i < an; i++) {
+    limb_t y = (i < bn ? b[i] : 0);
+    limb_t d = a[i] - y - borrow;
+    borrow = (a[i] < y || (borrow != 0 && a[i] == y));
+    if (d != 0) {
+      size = i + 1;
+    }
+  }
+  return size;
+}
+
+// signed value living in a caller-provided buffer, used by Toom-Cook
+// interpolation where intermediate values may be negative
+
+struct signed_limbs {
+  limb_t* p;
+  size_t n;
+  bool neg;
+
+  void normalize() {
+    n = normalized_size(p, n);
+    if (n == 0) {
+      neg = false;
+    }
+  }
+
+  void assign(limb_t const* a, size_t an) {
+    std::copy(a, a + an, p);
+    n = an;
+    neg = false;
+    normalize();
+  }
+
+  // *this += (-1)^b_neg * b
+  void add(limb_t const* b, size_t bn, bool b_neg) {
+    bn = normalized_size(b, bn);
+    if (neg == b_neg) {
+      limb_t carry = (n >= bn ? add_limbs(p, p, n, b, bn) : add_limbs(p, b, bn, p, n));
+      n = std::max(n, bn);
+      p[n++] = carry;
+    } else if (cmp_limbs(p, n, b, bn) >= 0) {
+      sub_limbs(p, p, n, b, bn);
+    } else {
+      sub_limbs(p, b, bn, p, n);
+      n = bn;
+      neg = b_neg;
+    }
+    normalize();
+  }
+
+  void add(signed_limbs const& b, bool negate) {
+    add(b.p, b.n, b.neg ^ negate);
+  }
+
+  void mul_small(int64_t m) {
+    if (m != 1 && m != -1) {
+      p[n] = mul_1(p, p, n, (limb_t) std::abs(m));
+      n++;
+    }
+    neg ^= (m < 0);
+    normalize();
+  }
+
+  void divexact_small(int64_t d) {
+    divexact_1(p, p, n, (limb_t) std::abs(d));
+    neg ^= (d < 0);
+    normalize();
+  }
+};
+
+// r[0..2n) = a^2: every product a[i] a[j], i < j, is computed once and
+// doubled, then the squares a[i]^2 are added
+
+void sqr_basecase(limb_t* r, limb_t const* a, size_t n) {
+  std::fill(r, r + 2 * n, 0);
+  for (size_t i = 0; i + 1 < n; i++) {
+    r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+  }
+  limb_t high = 0;
+  for (size_t i = 0; i < 2 * n; i++) {
+    limb_t cur = r[i];
+    r[i] = (cur << 1) | high;
+    high = cur >> (LIMB_BITS - 1);
+  }
+  limb_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t sq = (dlimb_t) a[i] * a[i];
+    dlimb_t low = (dlimb_t) r[2 * i] + (limb_t) sq + carry;
+    r[2 * i] = (limb_t) low;
+    dlimb_t high_part = (dlimb_t) r[2 * i + 1] + (limb_t) (sq >> LIMB_BITS) + (limb_t) (low >> LIMB_BITS);
+    r[2 * i + 1] = (limb_t) high_part;
+    carry = (limb_t) (high_part >> LIMB_BITS);
+  }
+}
+
+// below this size (in limbs of the shorter operand) schoolbook is faster
+
+static const size_t KARATSUBA_THRESHOLD = 32;
+#ifdef BIGINT_LIMB64
+static const size_t TOOM3_THRESHOLD = 300;
+static const size_t TOOM4_THRESHOLD = 800;
+#else
+static const size_t TOOM3_THRESHOLD = 200;
+static const size_t TOOM4_THRESHOLD = 600;
+#endif
+
+void mul_limbs(limb_t* r, limb_t const* a, size_t an,
+               limb_t const* b, size_t bn, limb_t* scratch);
+
+// an >= 2 * bn - 1: multiply by bn-sized slices of a
+
+void mul_unbalanced(limb_t* r, limb_t const* a, size_t an,
+                    limb_t const* b, size_t bn, limb_t* scratch) {
+  mul_limbs(r, a, bn, b, bn, scratch);
+  std::fill(r + 2 * bn, r + an + bn, 0);
+  limb_t* tmp = scratch;
+  for (size_t i = bn; i < an; i += bn) {
+    size_t len = std::min(bn, an - i);
+    mul_limbs(tmp, a + i, len, b, bn, scratch + 2 * bn);
+    add_limbs(r + i, r + i, an + bn - i, tmp, len + bn);
+  }
+}
+
+// (a1 x + a0)(b1 x + b0) = a1 b1 x^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) x + a0 b0
+// requires (an + 1) / 2 < bn <= an
+
+void mul_karatsuba(limb_t* r, limb_t const* a, size_t an,
+                   limb_t const* b, size_t bn, limb_t* scratch) {
+  size_t h = (an + 1) / 2;
+  size_t a1n = an - h;
+  size_t b1n = bn - h;
+  limb_t* sa = scratch;
+  limb_t* sb = sa + h + 1;
+  limb_t* z1 = sb + h + 1;
+  limb_t* next = z1 + 2 * h + 2;
+
+  sa[h] = add_limbs(sa, a, h, a + h, a1n);
+  if (a == b && an == bn) {
+    sb = sa;
+  } else {
+    sb[h] = add_limbs(sb, b, h, b + h, b1n);
+  }
+  mul_limbs(z1, sa, h + 1, sb, h + 1, next);
+  mul_limbs(r, a, h, b, h, next);
+  mul_limbs(r + 2 * h, a + h, a1n, b + h, b1n, next);
+
+  sub_limbs(z1, z1, 2 * h + 2, r, 2 * h);
+  sub_limbs(z1, z1, 2 * h + 2, r + 2 * h, a1n + b1n);
+  // the middle coefficient is below x^(an + bn - 2h), so higher limbs are zero
+  add_limbs(r + h, r + h, an + bn - h, z1, std::min(2 * h + 2, an + bn - h));
+}
+
+// Toom-k: both operands are split into k parts of m limbs and viewed as
+// polynomials in x = BASE^m. Their product is evaluated at 2k - 2 small
+// points and at infinity, and the coefficients are recovered by Newton
+// interpolation, where every division is exact.
+
+static const int64_t TOOM_POINTS[] = {0, 1, -1, 2, -2, 3};
+
+size_t toom_part_size(size_t an, size_t k) {
+  return (an + k - 1) / k;
+}
+
+size_t toom_slot_size(size_t m) {
+  return 2 * m + 6;
+}
+
+bool toom_fits(size_t an, size_t bn, size_t k) {
+  return bn > (k - 1) * toom_part_size(an, k);
+}
+
+// p(x) for the k parts of a, the top part having top_n limbs
+
+void toom_evaluate(signed_limbs& res, limb_t const* a, size_t m,
+                   size_t top_n, size_t k, int64_t x) {
+  if (x == 0) {
+    res.assign(a, m);
+    return;
+  }
+  res.assign(a + (k - 1) * m, top_n);
+  for (size_t i = k - 1; i > 0; i--) {
+    res.mul_small(x);
+    res.add(a + (i - 1) * m, m, false);
+  }
+}
+
+void mul_toom(limb_t* r, limb_t const* a, size_t an,
+              limb_t const* b, size_t bn, size_t k, limb_t* scratch) {
+  size_t m = toom_part_size(an, k);
+  size_t a_top = an - (k - 1) * m;
+  size_t b_top = bn - (k - 1) * m;
+  size_t points = 2 * k - 2;
+  size_t slot = toom_slot_size(m);
+
+  // slots [0, points) hold the values at TOOM_POINTS, then infinity and a temporary
+  signed_limbs v[8];
+  for (size_t i = 0; i < points + 2; i++) {
+    v[i] = {scratch + i * slot, 0, false};
+  }
+  signed_limbs& inf = v[points];
+  signed_limbs& tmp = v[points + 1];
+  signed_limbs ea{scratch + (points + 2) * slot, 0, false};
+  signed_limbs eb{ea.p + m + 2, 0, false};
+  limb_t* next = eb.p + m + 2;
+
+  for (size_t i = 0; i < points; i++) {
+    toom_evaluate(ea, a, m, a_top, k, TOOM_POINTS[i]);
+    bool square = (a == b && an == bn);
+    signed_limbs& y = (square ? ea : eb);
+    if (!square) {
+      toom_evaluate(eb, b, m, b_top, k, TOOM_POINTS[i]);
+    }
+    if (ea.n == 0 || y.n == 0) {
+      v[i].n = 0;
+      v[i].neg = false;
+      continue;
+    }
+    mul_limbs(v[i].p, ea.p, ea.n, y.p, y.n, next);
+    v[i].n = ea.n + y.n;
+    v[i].neg = ea.neg ^ y.neg;
+    v[i].normalize();
+  }
+  mul_limbs(inf.p, a + (k - 1) * m, a_top, b + (k - 1) * m, b_top, next);
+  inf.n = a_top + b_top;
+  inf.neg = false;
+  inf.normalize();
+
+  // remove the leading coefficient, leaving a polynomial of degree points - 1
+  for (size_t i = 1; i < points; i++) {
+    int64_t x_pow = 1;
+    for (size_t j = 0; j < points; j++) {
+      x_pow *= TOOM_POINTS[i];
+    }
+    tmp.assign(inf.p, inf.n);
+    tmp.mul_small(x_pow);
+    v[i].add(tmp, true);
+  }
+
+  // divided differences
+  for (size_t j = 1; j < points; j++) {
+    for (size_t i = points - 1; i >= j; i--) {
+      v[i].add(v[i - 1], true);
+      int64_t d = TOOM_POINTS[i] - TOOM_POINTS[i - j];
+      if (d != 1) {
+        v[i].divexact_small(d);
+      }
+    }
+  }
+
+  // Newton basis to monomial basis
+  for (size_t i = points - 1; i > 0; i--) {
+    int64_t x = TOOM_POINTS[i - 1];
+    if (x == 0) {
+      continue;
+    }
+    for (size_t j = i - 1; j + 1 < points; j++) {
+      if (x == 1 || x == -1) {
+        v[j].add(v[j + 1], x == 1);
+        continue;
+      }
+      tmp.assign(v[j + 1].p, v[j + 1].n);
+      tmp.neg = v[j + 1].neg;
+      tmp.mul_small(x);
+      v[j].add(tmp, true);
+    }
+  }
+
+  std::fill(r, r + an + bn, 0);
+  for (size_t i = 0; i <= points; i++) {
+    add_limbs(r + i * m, r + i * m, an + bn - i * m, v[i].p, v[i].n);
+  }
+}
+
+// threads for multiplications, see set_mul_threads
+
+std::atomic<unsigned> mul_threads(1);
+std::atomic<size_t> mul_threads_min_limbs(1 << 13);
+
+// f(0), ..., f(count - 1) on up to threads threads, the calling one included;
+// indices are taken from a shared counter, so uneven pieces balance out. An
+// exception thrown by f on a helper is rethrown on the calling thread after
+// all of them are joined, and helpers that cannot be started leave their
+// share to the others
+
+void parallel_for(size_t count, unsigned threads, std::function<void(size_t)> const& f) {
+  size_t n = std::max<size_t>(std::min<size_t>(threads, count), 1);
+  std::atomic<size_t> next(0);
+  std::vector<std::exception_ptr> errors(n);
+  auto work = [&](size_t w) {
+    try {
+      for (size_t i = next++; i < count; i = next++) {
+        f(i);
+      }
+    } catch (...) {
+      errors[w] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> helpers;
+  helpers.reserve(n - 1);
+  for (size_t w = 1; w < n; w++) {
+    try {
+      helpers.emplace_back(work, w);
+    } catch (...) {
+      break;
+    }
+  }
+  work(0);
+  for (std::thread& t : helpers) {
+    t.join();
+  }
+  for (std::exception_ptr const& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+#ifdef __SIZEOF_INT128__
+
+// number-theoretic transform multiplication: operands are cut into 64-bit
+// coefficients, convolved modulo three 62-bit primes and recombined with
+// the Chinese remainder theorem. Each convolution term is below
+// len * 2^128, well under the 2^185 product of the primes.
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+struct ntt_prime {
+  ntt_prime(uint64_t p, uint64_t g) : p(p), neg_inv(-limb_inverse(p)), r2(0) {
+    uint64_t r1 = (0 - p) % p;
+    r2 = (uint128_t) r1 * r1 % p;
+    root = to_mont(g);
+  }
+
+  // Montgomery reduction, t < p * 2^64
+  uint64_t reduce(uint128_t t) const {
+    uint64_t m = (uint64_t) t * neg_inv;
+    uint64_t res = (t + (uint128_t) m * p) >> 64;
+    return res >= p ? res - p : res;
+  }
+
+  uint64_t mul(uint64_t a, uint64_t b) const {
+    return reduce((uint128_t) a * b);
+  }
+
+  uint64_t add(uint64_t a, uint64_t b) const {
+    uint64_t res = a + b;
+    return res >= p ? res - p : res;
+  }
+
+  uint64_t sub(uint64_t a, uint64_t b) const {
+    return a >= b ? a - b : a + p - b;
+  }
+
+  uint64_t to_mont(uint64_t a) const {
+    return mul(a % p, r2);
+  }
+
+  uint64_t pow(uint64_t a, uint64_t e) const {
+    uint64_t res = to_mont(1);
+    while (e > 0) {
+      if (e & 1) {
+        res = mul(res, a);
+      }
+      a = mul(a, a);
+      e >>= 1;
+    }
+    return res;
+  }
+
+  uint64_t p;
+  uint64_t neg_inv;
+  uint64_t r2;
+  uint64_t root;
+};
+
+// all three have 2^42 dividing p - 1
+
+static const ntt_prime NTT_PRIMES[] = {
+    {4611615649683210241ULL, 11},
+    {4611549678985543681ULL, 19},
+    {4611496902427410433ULL, 5}};
+
+// crossover against Toom-4 on balanced products of random operands, best
+// of seven runs per size; the NTT gets slower in steps at each power-of-two
+// transform length, so these are the sizes from which it wins on average.
+// Toom-4 on 64-bit limbs is about twice as fast per bit, which moves the
+// 64-bit crossover to 32000 limbs (64000 32-bit limbs)
+#ifdef BIGINT_LIMB64
+static const size_t NTT_THRESHOLD = 32000;
+#else
+static const size_t NTT_THRESHOLD = 8000;
+#endif
+
+// limbs per 64-bit coefficient
+static const size_t NTT_LIMBS = 8 / sizeof(limb_t);
+
+// roots[len + j] = w^j for a primitive (2 len)-th root w, len = 1, 2, 4, ..., n / 2
+
+void ntt_roots(ntt_prime const& pr, std::vector<uint64_t>& roots, size_t n, bool inverse) {
+  roots.resize(n);
+  for (size_t len = 1; len < n; len *= 2) {
+    uint64_t w = pr.pow(pr.root, (pr.p - 1) / (2 * len));
+    if (inverse) {
+      w = pr.pow(w, 2 * len - 1);
+    }
+    uint64_t cur = pr.to_mont(1);
+    for (size_t j = 0; j < len; j++) {
+      roots[len + j] = cur;
+      cur = pr.mul(cur, w);
+    }
+  }
+}
+
+// decimation in frequency, output in bit-reversed order
+
+void ntt_forward(ntt_prime const& pr, uint64_t* a, size_t n, uint64_t const* roots) {
+  for (size_t len = n / 2; len >= 1; len /= 2) {
+    for (size_t i = 0; i < n; i += 2 * len) {
+      for (size_t j = 0; j < len; j++) {
+        uint64_t u = a[i + j];
+        uint64_t v = a[i + j + len];
+        a[i + j] = pr.add(u, v);
+        a[i + j + len] = pr.mul(pr.sub(u, v), roots[len + j]);
+      }
+    }
+  }
+}
+
+// decimation in time from bit-reversed order, without the 1 / n factor
+
+void ntt_inverse(ntt_prime const& pr, uint64_t* a, size_t n, uint64_t const* roots) {
+  for (size_t len = 1; len < n; len *= 2) {
+    for (size_t i = 0; i < n; i += 2 * len) {
+      for (size_t j = 0; j < len; j++) {
+        uint64_t u = a[i + j];
+        uint64_t v = pr.mul(a[i + j + len], roots[len + j]);
+        a[i + j] = pr.add(u, v);
+        a[i + j + len] = pr.sub(u, v);
+      }
+    }
+  }
+}
+
+void ntt_load(ntt_prime const& pr, uint64_t* res, size_t n, limb_t const* a, size_t an) {
+  size_t i = 0;
+  for (; NTT_LIMBS * i < an; i++) {
+    uint64_t coef = 0;
+    for (size_t j = 0; j < NTT_LIMBS && NTT_LIMBS * i + j < an; j++) {
+      coef |= (uint64_t) a[NTT_LIMBS * i + j] << (j * LIMB_BITS);
+    }
+    res[i] = pr.to_mont(coef);
+  }
+  std::fill(res + i, res + n, 0);
+}
+
+// a * b modulo the k-th prime, as plain residues
+
+void ntt_convolve(size_t k, uint64_t* res, uint64_t* tmp, size_t n,
+                  limb_t const* a, size_t an, limb_t const* b, size_t bn) {
+  ntt_prime const& pr = NTT_PRIMES[k];
+  std::vector<uint64_t> roots;
+  ntt_roots(pr, roots, n, false);
+  ntt_load(pr, res, n, a, an);
+  ntt_forward(pr, res, n, roots.data());
+  if (a == b && an == bn) {
+    tmp = res;
+  } else {
+    ntt_load(pr, tmp, n, b, bn);
+    ntt_forward(pr, tmp, n, roots.data());
+  }
+  for (size_t i = 0; i < n; i++) {
+    res[i] = pr.mul(res[i], tmp[i]);
+  }
+  ntt_roots(pr, roots, n, true);
+  ntt_inverse(pr, res, n, roots.data());
+  // to_mont(n^-1) scaled back by one more reduction leaves plain values
+  uint64_t n_inv = pr.pow(pr.to_mont(n), pr.p - 2);
+  for (size_t i = 0; i < n; i++) {
+    res[i] = pr.reduce(pr.mul(res[i], n_inv));
+  }
+}
+
+void mul_ntt(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn) {
+  size_t len = (an + NTT_LIMBS - 1) / NTT_LIMBS + (bn + NTT_LIMBS - 1) / NTT_LIMBS - 1;
+  size_t n = 1;
+  while (n < len) {
+    n *= 2;
+  }
+  // the three convolutions are independent and run on up to three threads,
+  // each with its own buffer for the transform of b
+  unsigned threads = (std::min(an, bn) >= mul_threads_min_limbs ? mul_threads.load() : 1);
+  bool shared_tmp = (threads == 1 || (a == b && an == bn));
+  std::vector<uint64_t> residues((shared_tmp ? 4 : 6) * n);
+  parallel_for(3, threads, [&](size_t k) {
+    uint64_t* tmp = residues.data() + (shared_tmp ? 3 : 3 + k) * n;
+    ntt_convolve(k, residues.data() + k * n, tmp, n, a, an, b, bn);
+  });
+
+  ntt_prime const& p0 = NTT_PRIMES[0];
+  ntt_prime const& p1 = NTT_PRIMES[1];
+  ntt_prime const& p2 = NTT_PRIMES[2];
+  // Garner's constants in Montgomery form
+  uint64_t p0_inv_p1 = p1.pow(p1.to_mont(p0.p), p1.p - 2);
+  uint64_t p0_inv_p2 = p2.pow(p2.to_mont(p0.p), p2.p - 2);
+  uint64_t p1_inv_p2 = p2.pow(p2.to_mont(p1.p), p2.p - 2);
+  uint128_t p0p1 = (uint128_t) p0.p * p1.p;
+
+  // running sum of the recombined coefficients: the 64 bits written out and
+  // the carry c0, c1 into the next ones
+  uint64_t c0 = 0, c1 = 0;
+  size_t rn = an + bn;
+  for (size_t i = 0; NTT_LIMBS * i < rn; i++) {
+    uint64_t x0 = 0, t1 = 0, t2 = 0;
+    if (i < len) {
+      x0 = residues[i];
+      t1 = p1.mul(p1.sub(residues[n + i] % p1.p, x0 % p1.p), p0_inv_p1);
+      t2 = p2.mul(p2.sub(p2.mul(p2.sub(residues[2 * n + i], x0 % p2.p), p0_inv_p2), t1 % p2.p), p1_inv_p2);
+    }
+    // x0 + p0 * t1 + p0 * p1 * t2
+    uint128_t low = (uint128_t) p0.p * t1 + x0;
+    uint128_t mid = (uint128_t) (uint64_t) p0p1 * t2;
+    uint128_t high = (uint128_t) (uint64_t) (p0p1 >> 64) * t2;
+    uint128_t s = (uint128_t) c0 + (uint64_t) low + (uint64_t) mid;
+    uint64_t out = (uint64_t) s;
+    s = (s >> 64) + c1 + (uint64_t) (low >> 64) + (uint64_t) (mid >> 64) + (uint64_t) high;
+    c0 = (uint64_t) s;
+    s = (s >> 64) + (uint64_t) (high >> 64);
+    c1 = (uint64_t) s;
+
+    for (size_t j = 0; j < NTT_LIMBS && NTT_LIMBS * i + j < rn; j++) {
+      r[NTT_LIMBS * i + j] = (limb_t) (out >> (j * LIMB_BITS));
+    }
+  }
+}
+
+#endif
+
+void mul_limbs(limb_t* r, limb_t const* a, size_t an,
+               limb_t const* b, size_t bn, limb_t* scratch) {
+  if (an < bn) {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  // for a square every algorithm below skips the work on the second operand
+  if (bn < KARATSUBA_THRESHOLD) {
+    if (a == b && an == bn) {
+      sqr_basecase(r, a, an);
+    } else {
+      mul_basecase(r, a, an, b, bn);
+    }
+#ifdef __SIZEOF_INT128__
+  } else if (bn >= NTT_THRESHOLD) {
+    mul_ntt(r, a, an, b, bn);
+#endif
+  } else if (bn <= (an + 1) / 2) {
+    mul_unbalanced(r, a, an, b, bn, scratch);
+  } else if (bn >= TOOM4_THRESHOLD && toom_fits(an, bn, 4)) {
+    mul_toom(r, a, an, b, bn, 4, scratch);
+  } else if (bn >= TOOM3_THRESHOLD && toom_fits(an, bn, 3)) {
+    mul_toom(r, a, an, b, bn, 3, scratch);
+  } else {
+    mul_karatsuba(r, a, an, b, bn, scratch);
+  }
+}
+
+// upper bound of the scratch used by mul_limbs when both operands have
+// at most n limbs: a level takes the most scratch any algorithm may need
+// for that size, and no algorithm recurses on more than h + 1 limbs
+
+size_t mul_scratch_size(size_t n) {
+  size_t res = 0;
+  while (n >= KARATSUBA_THRESHOLD) {
+    size_t h = (n + 1) / 2;
+    size_t level = 4 * h + 4;
+    for (size_t k = 3; k <= 4; k++) {
+      size_t m = toom_part_size(n, k);
+      level = std::max(level, 2 * k * toom_slot_size(m) + 2 * (m + 2));
+    }
+    res += level;
+    n = h + 1;
+  }
+  return res;
+}
+
+// Mulders' short products: the full product of the k = 0.7n limbs that
+// matter most plus two short products of the remaining n - k
+
+static const size_t MULDERS_THRESHOLD = 64;
+
+size_t mul_short_scratch_size(size_t n) {
+  return mul_scratch_size(n) + 2 * n;
+}
+
+// r[0..2n) = a b for a and b of n limbs, except for some of the products
+// a_i b_j with i + j < n - 1, so every column from n - 1 up is complete
+void mul_high_limbs(limb_t* r, limb_t const* a, limb_t const* b, size_t n,
+                    limb_t* scratch) {
+  if (n < MULDERS_THRESHOLD) {
+    std::fill(r, r + (n - 1), 0);
+    mul_high_basecase(r + (n - 1), a, n, b, n, n - 1);
+    return;
+  }
+  size_t k = (7 * n + 9) / 10;
+  size_t l = n - k;
+  std::fill(r, r + 2 * l, 0);
+  mul_limbs(r + 2 * l, a + l, k, b + l, k, scratch);
+  limb_t* t = scratch;
+  mul_high_limbs(t, a, b + k, l, t + 2 * l);
+  add_limbs(r + k, r + k, 2 * n - k, t, 2 * l);
+  mul_high_limbs(t, a + k, b, l, t + 2 * l);
+  add_limbs(r + k, r + k, 2 * n - k, t, 2 * l);
+}
+
+// r[0..n) = a b mod BASE^n for a and b of n limbs
+void mul_low_limbs(limb_t* r, limb_t const* a, limb_t const* b, size_t n,
+                   limb_t* scratch) {
+  if (n < MULDERS_THRESHOLD) {
+    mul_low_basecase(r, a, n, b, n, n);
+    return;
+  }
+  size_t k = (7 * n + 9) / 10;
+  size_t l = n - k;
+  limb_t* t = scratch;
+  mul_limbs(t, a, k, b, k, t + 2 * k);
+  std::copy(t, t + n, r);
+  mul_low_limbs(t, a + k, b, l, t + l);
+  add_limbs(r + k, r + k, l, t, l);
+  mul_low_limbs(t, a, b + k, l, t + l);
+  add_limbs(r + k, r + k, l, t, l);
+}
+
+// r[0..n) = t / BASE^n mod m for t < m BASE^n, destroys t[0..2n);
+// m_inv = -1 / m mod BASE makes each step clear the lowest limb of t
+
+void redc(limb_t* r, limb_t* t, limb_t const* m, size_t n, limb_t m_inv) {
+  limb_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    limb_t c = addmul_1(t + i, m, n, t[i] * m_inv);
+    dlimb_t cur = (dlimb_t) t[i + n] + c + carry;
+    t[i + n] = (limb_t) cur;
+    carry = (limb_t) (cur >> LIMB_BITS);
+  }
+  // the result is below 2m
+  if (carry != 0 || cmp_limbs(t + n, normalized_size(t + n, n), m, n) >= 0) {
+    sub_limbs(r, t + n, n, m, n);
+  } else {
+    std::copy(t + n, t + 2 * n, r);
+  }
+}
+
+// r[0..n) = a b / BASE^n mod m, t holds 2n limbs
+void mont_mul(limb_t* r, limb_t const* a, limb_t const* b, limb_t const* m, size_t n,
+              limb_t m_inv, limb_t* t, limb_t* scratch) {
+  mul_limbs(t, a, n, b, n, scratch);
+  redc(r, t, m, n, m_inv);
+}
+
+// sliding window width for an exponent of the given number of bits, the
+// table of odd powers costs 2^(k - 1) multiplications
+int window_bits(size_t bits) {
+  static const size_t limits[] = {8, 24, 80, 240, 672};
+  int k = 1;
+  for (size_t limit : limits) {
+    if (bits > limit) {
+      k++;
+    }
+  }
+  return k;
+}
+
+// bits [sh, sh + 2 LIMB_BITS) of a[0..n)
+dlimb_t bits_at(limb_t const* a, size_t n, size_t sh) {
+  size_t w = sh / LIMB_BITS;
+  int off = sh % LIMB_BITS;
+  auto limb = [&](size_t i) -> dlimb_t {
+    return i < n ? a[i] : 0;
+  };
+  dlimb_t res = ((limb(w + 1) << LIMB_BITS) | limb(w)) >> off;
+  if (off != 0) {
+    res |= limb(w + 2) << (2 * LIMB_BITS - off);
+  }
+  return res;
 }
 
-big_integer::big_integer(const std::string& str) : big_integer() {
-  if (str.empty() || str == "-") {
-    throw std::invalid_argument("Invalid number");
-  }
-  bool is_neg = str[0] == '-';
-  for (size_t i = is_neg; i < str.size(); i++) {
-    if (!('0' <= str[i] && str[i] <= '9')) {
-      throw std::invalid_argument("Invalid number");
-    }
+// r[0..n) = u x - v y for a result known to be non-negative
+void mul_sub_limbs(limb_t* r, limb_t const* x, limb_t u, limb_t const* y, limb_t v, size_t n) {
+  limb_t carry_x = 0;
+  limb_t carry_y = 0;
+  limb_t borrow = 0;
+  for (size_t i = 0; i < n; i++) {
+    dlimb_t px = (dlimb_t) x[i] * u + carry_x;
+    dlimb_t py = (dlimb_t) y[i] * v + carry_y;
+    carry_x = (limb_t) (px >> LIMB_BITS);
+    carry_y = (limb_t) (py >> LIMB_BITS);
+    limb_t lx = (limb_t) px;
+    limb_t ly = (limb_t) py;
+    limb_t d = lx - ly;
+    r[i] = d - borrow;
+    borrow = (lx < ly) | (d < borrow);
   }
+}
+
+// magnitudes kept in limb vectors for the gcd, normalized, an empty vector
+// is zero
 
-  size_t i = is_neg;
-  for (; i + 9 <= str.size(); i += 9) {
-    *this *= DIGIT_BASE;
-    *this += std::stoi(str.substr(i, 9));
+// r = a b, r must not be a or b; scratch is grown as needed
+void mul_to(limb_vector& r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_vector& scratch) {
+  an = normalized_size(a, an);
+  bn = normalized_size(b, bn);
+  if (an == 0 || bn == 0) {
+    r.clear();
+    return;
   }
-  size_t len_last_digit = (str.size() - is_neg) % 9;
-  if (len_last_digit > 0) {
-    uint32_t power_10 = 1;
-    while (len_last_digit > 0) {
-      power_10 *= 10;
-      len_last_digit--;
-    }
-    *this *= power_10;
-    *this += std::stoi(str.substr(i));
+  r.resize(an + bn);
+  size_t need = mul_scratch_size(std::max(an, bn));
+  if (scratch.size() < need) {
+    scratch.resize(need);
   }
-  if (is_neg)
-    this->sign = true;
-  cut_leading_zero(*this);
+  mul_limbs(r.data(), a, an, b, bn, scratch.data());
+  r.resize(normalized_size(r.data(), an + bn));
 }
 
-big_integer::~big_integer() = default;
+// r += a
+void add_to(limb_vector& r, limb_vector const& a) {
+  size_t n = std::max(r.size(), a.size());
+  r.resize(n + 1);
+  r[n] = add_limbs(r.data(), r.data(), n, a.data(), a.size());
+  r.resize(normalized_size(r.data(), n + 1));
+}
 
-void big_integer::swap(big_integer& a) {
-  std::swap(number, a.number);
-  std::swap(sign, a.sign);
+// r = x u + y v, r must not be any of the inputs, t is a temporary
+void mul_add(limb_vector& r, limb_vector const& x, limb_vector const& u,
+             limb_vector const& y, limb_vector const& v, limb_vector& t, limb_vector& scratch) {
+  mul_to(r, x.data(), x.size(), u.data(), u.size(), scratch);
+  mul_to(t, y.data(), y.size(), v.data(), v.size(), scratch);
+  add_to(r, t);
 }
 
-big_integer& big_integer::operator=(big_integer const& other) {
-  if (&other != this) {
-    big_integer(other).swap(*this);
-  }
-  return *this;
+// r = x u + y v for single limbs u and v, r must not be x or y
+void mul_add_1(limb_vector& r, limb_vector const& x, limb_t u, limb_vector const& y, limb_t v) {
+  size_t n = std::max(x.size(), y.size());
+  r.assign(n + 2, 0);
+  r[x.size()] = mul_1(r.data(), x.data(), x.size(), u);
+  limb_t carry = addmul_1(r.data(), y.data(), y.size(), v);
+  add_limbs(r.data() + y.size(), r.data() + y.size(), n + 2 - y.size(), &carry, 1);
+  r.resize(normalized_size(r.data(), n + 2));
 }
 
-void big_integer::cut_leading_zero(big_integer& num) {
-  size_t i = num.number.size();
-  while (i > 0 && num.number[i - 1] == 0) {
-    num.number.pop_back();
-    i--;
-  }
+} // namespace
+
+size_t limb_kernel_count() {
+  return all_kernels().count;
+}
+
+limb_kernels const& limb_kernel(size_t i) {
+  return all_kernels().list[i];
 }
 
 void big_integer::add_abs(big_integer& res, const big_integer& a, const big_integer& b) {
-  uint64_t carry = 0;
-  size_t max_size = std::max(a.number.size(), b.number.size());
-  res.number.resize(max_size + 1);
-  for (size_t i = 0; i < max_size; ++i) {
-    uint64_t cur_bit = (uint64_t) (i < a.number.size() ? a.number[i] : 0) +
-                       (uint64_t) (i < b.number.size() ? b.number[i] : 0) +
-                       carry;
-    carry = cur_bit / BASE;
-    res.number[i] = cur_bit - carry * BASE;
-  }
-  res.number[max_size] = carry;
+  big_integer const& x = (a.number.size() >= b.number.size() ? a : b);
+  big_integer const& y = (a.number.size() >= b.number.size() ? b : a);
+  size_t xn = x.number.size();
+  size_t yn = y.number.size();
+  res.number.resize(xn + 1);
+  res.number[xn] = add_limbs(res.number.data(), x.number.data(), xn, y.number.data(), yn);
   cut_leading_zero(res);
 }
 
@@ -136,22 +1611,12 @@ big_integer& big_integer::operator+=(big_integer const& rhs) {
   return *this;
 }
 
+// |a| >= |b|
 void big_integer::sub_abs(big_integer& diff, const big_integer& a, const big_integer& b) {
-  int64_t borrow = 0;
-  size_t max_size = std::max(a.number.size(), b.number.size());
-  diff.number.resize(max_size);
-  for (size_t i = 0; i < max_size; ++i) {
-    int64_t cur_bit = (int64_t) (i < a.number.size()? a.number[i]: 0) -
-                      (int64_t) (i < b.number.size() ? b.number[i] : 0) +
-                      borrow;
-    if (cur_bit < 0) {
-      cur_bit += BASE;
-      borrow = -1;
-    } else {
-      borrow = 0;
-    }
-    diff.number[i] = cur_bit;
-  }
+  size_t an = a.number.size();
+  size_t bn = b.number.size();
+  diff.number.resize(an);
+  sub_limbs(diff.number.data(), a.number.data(), an, b.number.data(), bn);
   cut_leading_zero(diff);
 }
 
@@ -175,17 +1640,16 @@ big_integer& big_integer::operator-=(big_integer const& rhs) {
 
 big_integer big_integer::mul_bigint_bigint(const big_integer& a, const big_integer& b) {
   big_integer res;
-  res.number.resize(a.number.size() + b.number.size() + 1);
-  for (size_t i = 0; i < a.number.size(); ++i){
-    uint64_t carry = 0;
-    for (size_t j = 0; j < b.number.size(); ++j){
-      uint64_t cur_bit = (uint64_t) a.number[i] * (uint64_t) (j < b.number.size()? b.number[j]: 0ULL) + res.number[i + j] + carry;
-      carry = (cur_bit) / BASE;
-      res.number[i + j] = cur_bit - BASE * carry;
-    }
-    if (carry > 0)
-      res.number[i + b.number.size()] += carry;
+  if (a.is_zero() || b.is_zero()) {
+    return res;
   }
+  size_t an = a.number.size();
+  size_t bn = b.number.size();
+  res.number.resize(an + bn);
+  limb_vector scratch(mul_scratch_size(std::max(an, bn)));
+  // equal magnitudes take the squaring path
+  limb_t const* b_data = (a.number == b.number ? a.number.data() : b.number.data());
+  mul_limbs(res.number.data(), a.number.data(), an, b_data, bn, scratch.data());
   res.sign = a.sign ^ b.sign;
   cut_leading_zero(res);
   return res;
@@ -196,70 +1660,511 @@ big_integer& big_integer::operator*=(big_integer const& rhs) {
   return *this;
 }
 
-uint64_t big_integer::trial(const big_integer& a, const big_integer& b, size_t k, size_t m) {
-  size_t km = k + m;
-  if (a == 0) return 0;
-  uint64_t r2 = ((uint64_t )a.number[km] * BASE +
-                (uint64_t )a.number[km - 1]) ;
-  uint64_t d1 = (uint64_t )b.number[m - 1] ;
-  return std::min((r2 / d1), (uint64_t)(BASE - 1));
+big_integer sqr(big_integer const& a) {
+  return big_integer::mul_bigint_bigint(a, a);
 }
 
-bool big_integer::smaller(const big_integer& r, const big_integer& dq, size_t k, size_t m) {
-  size_t i = m, j = 0;
-  while (i != j) {
-    if (r.number[i + k] != dq.number[i]) j = i;
-    else i--;
+void set_mul_threads(unsigned threads, size_t min_limbs) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
   }
-  return r.number[i + k] < dq.number[i];
+  mul_threads = threads;
+  mul_threads_min_limbs = min_limbs;
+}
+
+size_t ntt_threshold() {
+#ifdef __SIZEOF_INT128__
+  return NTT_THRESHOLD;
+#else
+  return 0;
+#endif
 }
 
+// Knuth, TAOCP vol. 2, 4.3.1, algorithm D on the limbs of the remainder:
+// with the top bit of the divisor set, the estimate from two limbs that is
+// checked against the second divisor limb is at most 1 too large, and the
+// multiply-subtract is undone by a single add-back when it was
+
 std::pair<big_integer, big_integer> big_integer::long_divide(big_integer const& a, big_integer const& b) {
-  uint64_t f = BASE / (b.number.back() + 1);
-  big_integer r = a * f;
-  big_integer d = b * f;
+  size_t n = b.number.size();
+  size_t an = a.number.size();
+  int s = 0;
+  while ((b.number.back() << s >> (LIMB_BITS - 1)) == 0) {
+    s++;
+  }
+  limb_vector d(n);
+  big_integer r;
+  r.number.resize(an + 1);
+  if (s == 0) {
+    std::copy(b.number.begin(), b.number.end(), d.data());
+    std::copy(a.number.begin(), a.number.end(), r.number.data());
+  } else {
+    lshift_limbs(d.data(), b.number.data(), n, s);
+    r.number[an] = lshift_limbs(r.number.data(), a.number.data(), an, s);
+  }
   big_integer q;
-  q.number.resize(a.number.size() - b.number.size() + 2);
-  r.number.push_back(0);
-  for (size_t k = a.number.size() - b.number.size() + 1; k > 0; k--) {
-    uint64_t qt = trial(r, d, k - 1, b.number.size());
-    big_integer dq = d * qt;
-   if (qt == 0) continue;
-    dq.number.push_back(0);
-    while (qt != 0 && smaller(r, dq, k - 1, b.number.size())) {
+  q.number.resize(an - n + 1);
+  limb_t d1 = d[n - 1];
+  limb_t d0 = d[n - 2];
+  for (size_t j = an - n + 1; j > 0; j--) {
+    limb_t* rj = r.number.data() + (j - 1);
+    dlimb_t top = (dlimb_t) rj[n] << LIMB_BITS | rj[n - 1];
+    dlimb_t qt = top / d1;
+    dlimb_t rt = top % d1;
+    while (qt > LIMB_MAX || qt * d0 > (rt << LIMB_BITS | rj[n - 2])) {
       qt--;
-      dq -= d;
+      rt += d1;
+      if (rt > LIMB_MAX) {
+        break;
+      }
     }
-    q.number[k - 1] = qt;
-
-    uint64_t borrow = 0;
-    for (size_t i = 0; i <= b.number.size(); i++) {
-      uint64_t diff = (uint64_t)r.number[i + k - 1] - dq.number[i] - borrow + BASE;
-      r.number[i + k - 1] = diff % BASE;
-      borrow = 1 - diff / BASE;
+    limb_t borrow = submul_1(rj, d.data(), n, (limb_t) qt);
+    if (rj[n] < borrow) {
+      qt--;
+      add_limbs(rj, rj, n, d.data(), n);
     }
+    rj[n] = 0;
+    q.number[j - 1] = (limb_t) qt;
   }
   cut_leading_zero(q);
-  r = divide_long_short(r, f);
+  r.number.resize(n);
+  if (s != 0) {
+    rshift_limbs(r.number.data(), r.number.data(), n, s);
+  }
   cut_leading_zero(r);
   return {q, r};
 }
 
-big_integer big_integer::divide_long_short(big_integer const&a, uint32_t b) {
+// Burnikel and Ziegler, "Fast Recursive Division" (1998): a 2n by n limb
+// division is done as two 3/2 by 1 divisions of half size, each costing
+// one half size division and one multiplication
+
+static const size_t BURNIKEL_ZIEGLER_THRESHOLD = 48;
+
+// above this, both for the divisor and the quotient, Newton division wins:
+// on 2n by n divisions the two are level from about 1.3e5 to 5e5 32-bit
+// limbs and meet at about 1e6 64-bit limbs
+
+#ifdef BIGINT_LIMB64
+static const size_t NEWTON_DIVISION_THRESHOLD = 1000000;
+#else
+static const size_t NEWTON_DIVISION_THRESHOLD = 250000;
+#endif
+
+big_integer big_integer::limbs_slice(big_integer const& a, size_t from, size_t to) {
+  big_integer res;
+  to = std::min(to, a.number.size());
+  if (from < to) {
+    res.number.assign(a.number.begin() + from, a.number.begin() + to);
+    cut_leading_zero(res);
+  }
+  return res;
+}
+
+big_integer& big_integer::shift_limbs(big_integer& a, size_t k) {
+  if (!a.is_zero()) {
+    a.number.insert(a.number.begin(), k, 0);
+  }
+  return a;
+}
+
+// magnitudes of a and b, b has at least two limbs
+
+std::pair<big_integer, big_integer> big_integer::divide_abs(big_integer const& a, big_integer const& b) {
+  if (cmp_limbs(a.number.data(), a.number.size(), b.number.data(), b.number.size()) < 0) {
+    big_integer r = a;
+    r.sign = false;
+    return {big_integer(), r};
+  }
+  if (b.number.size() >= NEWTON_DIVISION_THRESHOLD &&
+      a.number.size() - b.number.size() >= NEWTON_DIVISION_THRESHOLD) {
+    big_integer d = b;
+    d.sign = false;
+    return divide_newton(a, d, newton_inverse(d));
+  }
+  if (b.number.size() >= BURNIKEL_ZIEGLER_THRESHOLD &&
+      a.number.size() - b.number.size() >= BURNIKEL_ZIEGLER_THRESHOLD) {
+    return divide_bz(a, b);
+  }
+  auto res = long_divide(a, b);
+  res.first.sign = false;
+  res.second.sign = false;
+  return res;
+}
+
+// a < b * BASE^h, b has 2h limbs and its top bit set
+
+std::pair<big_integer, big_integer> big_integer::div_3n_2n(big_integer const& a, big_integer const& b, size_t h) {
+  big_integer a12 = limbs_slice(a, h, 3 * h);
+  big_integer b1 = limbs_slice(b, h, 2 * h);
+  big_integer q, r;
+  if (limbs_slice(a, 2 * h, 3 * h).comp_abs_less(b1)) {
+    std::tie(q, r) = div_2n_1n(a12, b1, h);
+  } else {
+    // the quotient estimate is capped at BASE^h - 1
+    q.number.assign(h, LIMB_MAX);
+    r = a12 - shift_limbs(b1, h) + limbs_slice(b, h, 2 * h);
+  }
+  shift_limbs(r, h);
+  r += limbs_slice(a, 0, h);
+  r -= q * limbs_slice(b, 0, h);
+  while (r.sign && !r.is_zero()) {
+    --q;
+    r += b;
+  }
+  r.sign = false;
+  return {q, r};
+}
+
+// a < b * BASE^n, b has n limbs and its top bit set
+
+std::pair<big_integer, big_integer> big_integer::div_2n_1n(big_integer const& a, big_integer const& b, size_t n) {
+  if (n % 2 != 0 || n < BURNIKEL_ZIEGLER_THRESHOLD) {
+    if (a.number.size() < b.number.size() || a.comp_abs_less(b)) {
+      return {big_integer(), a};
+    }
+    return long_divide(a, b);
+  }
+  size_t h = n / 2;
+  auto [q1, r] = div_3n_2n(limbs_slice(a, h, a.number.size()), b, h);
+  shift_limbs(r, h);
+  r += limbs_slice(a, 0, h);
+  auto [q2, s] = div_3n_2n(r, b, h);
+  shift_limbs(q1, h);
+  return {q1 + q2, s};
+}
+
+std::pair<big_integer, big_integer> big_integer::divide_bz(big_integer const& a, big_integer const& b) {
+  // pad b to n = j * 2^k limbs with j below the threshold and set its top bit
+  size_t s = b.number.size();
+  size_t m = 1;
+  while (m * BURNIKEL_ZIEGLER_THRESHOLD <= s) {
+    m *= 2;
+  }
+  size_t n = (s + m - 1) / m * m;
+  int bits = 0;
+  while (((limb_t) (b.number.back() << bits) >> (LIMB_BITS - 1)) == 0) {
+    bits++;
+  }
+  big_integer bb = b;
+  bb.sign = false;
+  bb <<= bits;
+  shift_limbs(bb, n - s);
+  big_integer aa = a;
+  aa.sign = false;
+  aa <<= bits;
+  shift_limbs(aa, n - s);
+
+  // the top block of aa stays below BASE^n / 2
+  size_t t = std::max<size_t>(2, aa.number.size() / n + 1);
+  big_integer q;
+  q.number.resize(t * n);
+  big_integer z = limbs_slice(aa, (t - 2) * n, t * n);
+  big_integer r;
+  for (size_t i = t - 1; i > 0; i--) {
+    big_integer qi;
+    std::tie(qi, r) = div_2n_1n(z, bb, n);
+    std::copy(qi.number.begin(), qi.number.end(), q.number.begin() + (i - 1) * n);
+    if (i > 1) {
+      z = shift_limbs(r, n) + limbs_slice(aa, (i - 2) * n, (i - 1) * n);
+    }
+  }
+  cut_leading_zero(q);
+  r = limbs_slice(r, n - s, r.number.size());
+  r >>= bits;
+  return {q, r};
+}
+
+// Newton-Raphson division: v = BASE^(2n) / d is refined from the inverse
+// of the top half of d, then every n limbs of the dividend cost two
+// n by n multiplications
+
+big_integer big_integer::newton_inverse(big_integer const& d) {
+  size_t n = d.number.size();
+  big_integer power = 1;
+  if (n <= BURNIKEL_ZIEGLER_THRESHOLD) {
+    shift_limbs(power, 2 * n);
+    return (n == 1 ? divide_long_short(power, d.number[0]) : divide_abs(power, d).first);
+  }
+  // x = y BASE^(n - h) approximates the result, y from the top h limbs of d,
+  // two guard limbs keep the Newton step within a few units of the result
+  size_t h = n / 2 + 2;
+  big_integer y = newton_inverse(limbs_slice(d, n - h, n));
+
+  // e = BASE^(n + h) - d y, so that BASE^2n - d x = e BASE^(n - h)
+  big_integer e = shift_limbs(power, n + h) - d * y;
+
+  // x += x e / BASE^2n, dropping the low limbs of e that cannot reach the integer part
+  big_integer step = limbs_slice(e, h - 3, e.number.size()) * y;
+  step = limbs_slice(step, h + 3, step.number.size());
+  step.sign = e.sign;
+
+  big_integer x = shift_limbs(y, n - h) + step;
+  big_integer r = shift_limbs(e, n - h) - d * step;
+  while (r.sign && !r.is_zero()) {
+    --x;
+    r += d;
+  }
+  while (!r.comp_abs_less(d)) {
+    ++x;
+    r -= d;
+  }
+  return x;
+}
+
+std::pair<big_integer, big_integer> big_integer::divide_newton(big_integer const& a, big_integer const& d,
+                                                               big_integer const& v) {
+  size_t n = d.number.size();
+  size_t blocks = (a.number.size() + n - 1) / n;
+  big_integer q;
+  q.number.resize(blocks * n);
+  big_integer r;
+  for (size_t i = blocks; i > 0; i--) {
+    // r < d, so x < d BASE^n and its quotient fits in n limbs
+    big_integer x = shift_limbs(r, n) + limbs_slice(a, (i - 1) * n, i * n);
+    x.sign = false;
+    if (x.comp_abs_less(d)) {
+      r = x;
+      continue;
+    }
+    big_integer qi = limbs_slice(limbs_slice(x, n - 1, 2 * n) * v, n + 1, 3 * n + 2);
+    r = x - qi * d;
+    while (!r.comp_abs_less(d)) {
+      ++qi;
+      r -= d;
+    }
+    std::copy(qi.number.begin(), qi.number.end(), q.number.begin() + (i - 1) * n);
+  }
+  cut_leading_zero(q);
+  r.sign = false;
+  return {q, r};
+}
+
+big_reciprocal::big_reciprocal(big_integer const& d, big_integer const& v) : d(d), v(v) {}
+
+big_integer const& big_reciprocal::divisor() const {
+  return d;
+}
+
+big_reciprocal big_integer::reciprocal() const {
+  if (is_zero()) {
+    throw std::runtime_error("Division by zero");
+  }
+  big_integer d = *this;
+  d.sign = false;
+  return big_reciprocal(*this, newton_inverse(d));
+}
+
+big_integer& big_integer::operator/=(big_reciprocal const& rhs) {
+  bool div_sign = (this->sign ^ rhs.d.sign);
+  big_integer d = rhs.d;
+  d.sign = false;
+  divide_newton(*this, d, rhs.v).first.swap(*this);
+  this->sign = div_sign && !is_zero();
+  return *this;
+}
+
+big_integer& big_integer::operator%=(big_reciprocal const& rhs) {
+  bool div_sign = this->sign;
+  big_integer d = rhs.d;
+  d.sign = false;
+  divide_newton(*this, d, rhs.v).second.swap(*this);
+  this->sign = div_sign && !is_zero();
+  return *this;
+}
+
+barrett_reducer::barrett_reducer(big_integer const& m) : rec(m.reciprocal()) {}
+
+big_integer const& barrett_reducer::modulus() const {
+  return rec.divisor();
+}
+
+// q = x v / BASE^(2n) computed from the top n + 2 limbs of x is at most two
+// below the quotient, and skipping the products of x v in the columns below
+// n + 1, which add less than one to it, costs at most one more; so only the
+// low n + 1 limbs of x - q m are needed
+big_integer& big_integer::operator%=(barrett_reducer const& rhs) {
+  limb_vector const& m = rhs.rec.d.number;
+  limb_vector const& v = rhs.rec.v.number;
+  size_t n = m.size();
+  size_t xn = number.size();
+  // v has n + 2 limbs only for m = BASE^(n - 1)
+  if (xn > 2 * n || n < 2 || v.size() > n + 1) {
+    return *this %= rhs.rec;
+  }
+  if (cmp_limbs(number.data(), xn, m.data(), n) < 0) {
+    return *this;
+  }
+  // both factors padded to N = n + 2 limbs: x from limb n - 2 and v B
+  size_t N = n + 2;
+  size_t top = xn - (n - 2);
+  limb_vector buffer(5 * N + mul_short_scratch_size(N));
+  limb_t* x = buffer.data();
+  limb_t* y = x + N;
+  limb_t* q = y + N;
+  limb_t* scratch = q + 2 * N;
+  std::copy(number.data() + (n - 2), number.data() + xn, x);
+  std::fill(x + top, x + N, 0);
+  y[0] = 0;
+  std::copy(v.begin(), v.end(), y + 1);
+  std::fill(y + 1 + v.size(), y + N, 0);
+  mul_high_limbs(q, x, y, N, scratch);
+  q += n + 3;
+
+  // the quotient is below BASE^(n + 1), m padded to n + 1 limbs in place of x
+  std::copy(m.begin(), m.end(), x);
+  x[n] = 0;
+  limb_t* qm = y;
+  mul_low_limbs(qm, q, x, n + 1, scratch);
+  number.resize(n + 1);
+  limb_t* r = number.data();
+  // modulo BASE^(n + 1), the true difference is below 4m
+  sub_limbs(r, r, n + 1, qm, n + 1);
+  while (cmp_limbs(r, normalized_size(r, n + 1), m.data(), n) >= 0) {
+    sub_limbs(r, r, n + 1, m.data(), n);
+  }
+  bool r_sign = sign;
+  cut_leading_zero(*this);
+  sign = r_sign && !is_zero();
+  return *this;
+}
+
+montgomery_context::montgomery_context(big_integer const& mod) : m(mod) {
+  m.sign = false;
+  if (m.is_zero() || m.number[0] % 2 == 0) {
+    throw std::invalid_argument("Montgomery modulus must be odd");
+  }
+  m_inv = -(limb_t) limb_inverse(m.number[0]);
+  r2 = (big_integer(1) << (int) (2 * LIMB_BITS * m.number.size())) % m;
+}
+
+big_integer const& montgomery_context::modulus() const {
+  return m;
+}
+
+big_integer montgomery_context::pow(big_integer const& base, big_integer const& exp) const {
+  if (exp.sign && !exp.is_zero()) {
+    throw std::invalid_argument("Negative exponent");
+  }
+  size_t n = m.number.size();
+  big_integer x = base % m;
+  if (x.sign) {
+    x += m;
+  }
+  x.number.resize(n);
+  size_t bits = exp.bit_length();
+  int k = window_bits(bits);
+  size_t odd_powers = (size_t) 1 << (k - 1);
+
+  // every limb the loop below touches: the table of odd powers x^1, x^3,
+  // ..., the accumulator, the product and the multiplication scratch
+  limb_vector buffer((odd_powers + 2) * n + 2 * n + mul_scratch_size(n));
+  limb_t* table = buffer.data();
+  limb_t* x2 = table + odd_powers * n;
+  limb_t* acc = x2 + n;
+  limb_t* t = acc + n;
+  limb_t* scratch = t + 2 * n;
+  limb_t const* mp = m.number.data();
+
+  big_integer r2_limbs = r2;
+  r2_limbs.number.resize(n);
+  mont_mul(table, x.number.data(), r2_limbs.number.data(), mp, n, m_inv, t, scratch);
+  mont_mul(x2, table, table, mp, n, m_inv, t, scratch);
+  for (size_t i = 1; i < odd_powers; i++) {
+    mont_mul(table + i * n, table + (i - 1) * n, x2, mp, n, m_inv, t, scratch);
+  }
+
+  // left to right over windows that start and end with a one bit
+  bool started = false;
+  size_t i = bits;
+  while (i > 0) {
+    if (!exp.test_bit(i - 1)) {
+      if (started) {
+        mont_mul(acc, acc, acc, mp, n, m_inv, t, scratch);
+      }
+      i--;
+      continue;
+    }
+    size_t low = (i >= (size_t) k ? i - k : 0);
+    while (!exp.test_bit(low)) {
+      low++;
+    }
+    size_t window = 0;
+    for (size_t j = i; j > low; j--) {
+      window = 2 * window + exp.test_bit(j - 1);
+      if (started) {
+        mont_mul(acc, acc, acc, mp, n, m_inv, t, scratch);
+      }
+    }
+    limb_t const* power = table + (window / 2) * n;
+    if (started) {
+      mont_mul(acc, acc, power, mp, n, m_inv, t, scratch);
+    } else {
+      std::copy(power, power + n, acc);
+      started = true;
+    }
+    i = low;
+  }
+
+  big_integer res;
+  if (!started) {
+    // exp = 0
+    res = big_integer(1) % m;
+    return res;
+  }
+  // out of the Montgomery form: acc / BASE^n
+  std::copy(acc, acc + n, t);
+  std::fill(t + n, t + 2 * n, 0);
+  res.number.resize(n);
+  redc(res.number.data(), t, mp, n, m_inv);
+  big_integer::cut_leading_zero(res);
+  return res;
+}
+
+// square and multiply with a precomputed reciprocal for moduli that have no
+// Montgomery form
+big_integer powmod(big_integer const& base, big_integer const& exp, big_integer const& mod) {
+  if (mod.test_bit(0)) {
+    return montgomery_context(mod).pow(base, exp);
+  }
+  if (exp.is_negative()) {
+    throw std::invalid_argument("Negative exponent");
+  }
+  big_reciprocal rec = mod.reciprocal();
+  big_integer m = (mod.is_negative() ? -mod : mod);
+  big_integer x = base % rec;
+  if (x.is_negative()) {
+    x += m;
+  }
+  big_integer res = big_integer(1) % rec;
+  for (size_t i = exp.bit_length(); i > 0; i--) {
+    res = sqr(res) % rec;
+    if (exp.test_bit(i - 1)) {
+      res = res * x % rec;
+    }
+  }
+  return res;
+}
+
+big_integer big_integer::divide_long_short(big_integer const&a, limb_t b) {
+  return divrem_long_short(a, b).first;
+}
+
+std::pair<big_integer, limb_t> big_integer::divrem_long_short(big_integer const& a, limb_t b) {
   big_integer res;
   res.number.resize(a.number.size());
-  uint64_t carry = 0;
+  limb_t carry = 0;
   for (size_t i = a.number.size(); i > 0; i--) {
-    uint64_t temp = carry * BASE + a.number[i - 1];
-    res.number[i - 1] = temp / b;
-    carry = temp % b;
+    dlimb_t temp = (dlimb_t) carry << LIMB_BITS | a.number[i - 1];
+    res.number[i - 1] = (limb_t) (temp / b);
+    carry = (limb_t) (temp % b);
   }
   cut_leading_zero(res);
-  return res;
+  return {res, carry};
 }
 
 big_integer& big_integer::operator/=(big_integer const& rhs) {
-  if (rhs == 0) {
+  if (rhs.is_zero()) {
     throw std::runtime_error("Division by zero");
   }
   bool div_sign = (this->sign ^ rhs.sign);
@@ -273,16 +2178,16 @@ big_integer& big_integer::operator/=(big_integer const& rhs) {
   if (this->number.size() < rhs.number.size()) {
     return (*this = 0);
   } else {
-    long_divide(*this, rhs).first.swap(*this);
+    divide_abs(*this, rhs).first.swap(*this);
     this->sign = div_sign;
     return *this;
   }
 }
 
-big_integer big_integer::remainder_long_short(const big_integer& a, uint32_t b) {
-  uint64_t carry = 0;
+big_integer big_integer::remainder_long_short(const big_integer& a, limb_t b) {
+  limb_t carry = 0;
   for (size_t i = a.number.size(); i > 0; i--) {
-    carry = (carry * BASE + a.number[i - 1]) % b;
+    carry = (limb_t) (((dlimb_t) carry << LIMB_BITS | a.number[i - 1]) % b);
   }
   big_integer res(carry);
   res.sign = a.sign;
@@ -290,7 +2195,7 @@ big_integer big_integer::remainder_long_short(const big_integer& a, uint32_t b)
 }
 
 big_integer& big_integer::operator%=(big_integer const& rhs) {
-  if (rhs == 0) {
+  if (rhs.is_zero()) {
     throw std::runtime_error("Division by zero");
   }
   bool div_sign = this->sign;
@@ -301,123 +2206,775 @@ big_integer& big_integer::operator%=(big_integer const& rhs) {
     }
     return *this;
   }
-  if (comp_abs_less(rhs)) {
+  if (cmp_limbs(number.data(), number.size(), rhs.number.data(), rhs.number.size()) < 0) {
     return (*this);
   } else {
-    long_divide(*this, rhs).second.swap(*this);
+    divide_abs(*this, rhs).second.swap(*this);
     this->sign = div_sign;
     cut_leading_zero(*this);
     return *this;
   }
 }
 
-// two's complement for a -> ~a + 1
+std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b) {
+  if (b.is_zero()) {
+    throw std::runtime_error("Division by zero");
+  }
+  std::pair<big_integer, big_integer> res;
+  if (b.number.size() == 1) {
+    auto qr = big_integer::divrem_long_short(a, b.number[0]);
+    res.first = std::move(qr.first);
+    res.second = qr.second;
+  } else {
+    res = big_integer::divide_abs(a, b);
+    big_integer::cut_leading_zero(res.second);
+  }
+  res.first.sign = (a.sign ^ b.sign) && !res.first.is_zero();
+  res.second.sign = a.sign && !res.second.is_zero();
+  return res;
+}
+
+std::pair<big_integer, big_integer> divmod_floor(big_integer const& a, big_integer const& b) {
+  auto res = divmod(a, b);
+  if (res.second != 0 && (res.second < 0) != (b < 0)) {
+    --res.first;
+    res.second += b;
+  }
+  return res;
+}
+
+// below these sizes in limbs Lehmer steps are faster than the half-gcd
+
+static const size_t HGCD_THRESHOLD = 120;
+static const size_t GCD_HGCD_THRESHOLD = 240;
+
+// x' = a x + b y, y' = c x + d y after the given number of Euclid steps,
+// the signs of the cofactors alternate and they fit in a limb
+struct big_integer::lehmer_matrix {
+  sdlimb_t a, b, c, d;
+  size_t steps;
+};
+
+// (a, b) = M (a', b') for the numbers a', b' left after Euclid steps on
+// a and b, the entries are non-negative and det M = +-1
+struct big_integer::gcd_matrix {
+  limb_vector m00, m01, m10, m11;
+  bool det_negative = false;
+  // temporaries of the updates, kept to reuse their buffers
+  limb_vector t, u, w, scratch;
+
+  gcd_matrix() {
+    m00.push_back(1);
+    m11.push_back(1);
+  }
+
+  // M = M [[q, 1], [1, 0]] for a step a = q b + r
+  void step(limb_vector const& q) {
+    mul_to(t, m00.data(), m00.size(), q.data(), q.size(), scratch);
+    add_to(t, m01);
+    mul_to(u, m10.data(), m10.size(), q.data(), q.size(), scratch);
+    add_to(u, m11);
+    std::swap(m01, m00);
+    std::swap(m11, m10);
+    std::swap(m00, t);
+    std::swap(m10, u);
+    det_negative = !det_negative;
+  }
+
+  // M = M [[|d|, |b|], [|c|, |a|]], the inverse of the Lehmer steps
+  void lehmer(lehmer_matrix const& l) {
+    limb_t a = (limb_t) (l.a < 0 ? -l.a : l.a);
+    limb_t b = (limb_t) (l.b < 0 ? -l.b : l.b);
+    limb_t c = (limb_t) (l.c < 0 ? -l.c : l.c);
+    limb_t d = (limb_t) (l.d < 0 ? -l.d : l.d);
+    mul_add_1(t, m00, d, m01, c);
+    mul_add_1(u, m00, b, m01, a);
+    std::swap(m00, t);
+    std::swap(m01, u);
+    mul_add_1(t, m10, d, m11, c);
+    mul_add_1(u, m10, b, m11, a);
+    std::swap(m10, t);
+    std::swap(m11, u);
+    det_negative ^= (l.steps % 2 == 1);
+  }
+
+  // M = M N
+  void mul(gcd_matrix const& n) {
+    mul_add(t, m00, n.m00, m01, n.m10, w, scratch);
+    mul_add(u, m00, n.m01, m01, n.m11, w, scratch);
+    std::swap(m00, t);
+    std::swap(m01, u);
+    mul_add(t, m10, n.m00, m11, n.m10, w, scratch);
+    mul_add(u, m10, n.m01, m11, n.m11, w, scratch);
+    std::swap(m10, t);
+    std::swap(m11, u);
+    det_negative ^= n.det_negative;
+  }
+
+  // r = r BASE^p + det M (f x - g y) for the low p limbs x, y of the
+  // numbers, a row of M^-1 = det M [[m11, -m01], [-m10, m00]]; the result
+  // is known to be non-negative
+  void apply_inverse(big_integer& r, limb_vector const& f, limb_t const* x,
+                     limb_vector const& g, limb_t const* y, size_t p) {
+    mul_to(t, f.data(), f.size(), x, p, scratch);
+    mul_to(u, g.data(), g.size(), y, p, scratch);
+    bool negative = det_negative;
+    if (cmp_limbs(t.data(), t.size(), u.data(), u.size()) < 0) {
+      std::swap(t, u);
+      negative = !negative;
+    }
+    sub_limbs(t.data(), t.data(), t.size(), u.data(), u.size());
+    t.resize(normalized_size(t.data(), t.size()));
+    shift_limbs(r, p);
+    size_t n = r.number.size();
+    if (negative) {
+      sub_limbs(r.number.data(), r.number.data(), n, t.data(), t.size());
+    } else {
+      n = std::max(n, t.size());
+      r.number.resize(n + 1);
+      r.number[n] = add_limbs(r.number.data(), r.number.data(), n, t.data(), t.size());
+    }
+    cut_leading_zero(r);
+  }
+};
+
+// the cofactors s0, s1 with s0 a = x and s1 a = y modulo b while Euclid
+// steps take (a, b) to (x, y); their signs alternate, so they are kept as
+// magnitudes and every update only adds products
+struct big_integer::gcd_cofactors {
+  limb_vector s0, s1;
+  // the sign of s0, s1 has the other one
+  bool s0_negative = false;
+  limb_vector t, u, w, scratch;
+
+  // (s0, s1) = (s1, s0 - q s1)
+  void step(limb_vector const& q) {
+    mul_to(t, s1.data(), s1.size(), q.data(), q.size(), scratch);
+    add_to(t, s0);
+    std::swap(s0, s1);
+    std::swap(s1, t);
+    s0_negative = !s0_negative;
+  }
+
+  // (s0, s1) = L (s0, s1)
+  void lehmer(lehmer_matrix const& l) {
+    mul_add_1(t, s0, (limb_t) (l.a < 0 ? -l.a : l.a), s1, (limb_t) (l.b < 0 ? -l.b : l.b));
+    mul_add_1(u, s0, (limb_t) (l.c < 0 ? -l.c : l.c), s1, (limb_t) (l.d < 0 ? -l.d : l.d));
+    std::swap(s0, t);
+    std::swap(s1, u);
+    s0_negative ^= (l.steps % 2 == 1);
+  }
+
+  // (s0, s1) = M^-1 (s0, s1)
+  void hgcd(gcd_matrix const& m) {
+    mul_add(t, m.m11, s0, m.m01, s1, w, scratch);
+    mul_add(u, m.m10, s0, m.m00, s1, w, scratch);
+    std::swap(s0, t);
+    std::swap(s1, u);
+    s0_negative ^= m.det_negative;
+  }
+};
+
+// (x, y) = (y, x mod y), the cofactors follow the same step
+void big_integer::euclid_step(big_integer& x, big_integer& y, gcd_cofactors* c) {
+  auto qr = divmod(x, y);
+  x.swap(y);
+  y.swap(qr.second);
+  if (c != nullptr) {
+    c->step(qr.first.number);
+  }
+}
+
+// Knuth's algorithm L on the leading 2 LIMB_BITS - 2 bits of x >= y: a
+// quotient is only taken when it is the same at both ends of the interval
+// holding the true ratio, so every step is a step on x and y themselves;
+// the steps are kept if y is left with at least min_size limbs
+bool big_integer::lehmer_step(big_integer& x, big_integer& y, size_t min_size, lehmer_matrix& l,
+                              big_integer& t, big_integer& w) {
+  size_t n = x.number.size();
+  size_t bits = (n - 1) * LIMB_BITS;
+  for (limb_t top = x.number.back(); top != 0; top >>= 1) {
+    bits++;
+  }
+  size_t sh = (bits > 2 * LIMB_BITS - 2 ? bits - (2 * LIMB_BITS - 2) : 0);
+  sdlimb_t u = (sdlimb_t) bits_at(x.number.data(), n, sh);
+  sdlimb_t v = (sdlimb_t) bits_at(y.number.data(), y.number.size(), sh);
+  l = {1, 0, 0, 1, 0};
+  auto magnitude = [](sdlimb_t z) {
+    return z < 0 ? -z : z;
+  };
+  sdlimb_t const limit = LIMB_MAX;
+  while (v + l.c != 0 && v + l.d != 0) {
+    sdlimb_t q = (u + l.a) / (v + l.c);
+    if (q != (u + l.b) / (v + l.d)) {
+      break;
+    }
+    if ((l.c != 0 && q > (limit - magnitude(l.a)) / magnitude(l.c)) ||
+        (l.d != 0 && q > (limit - magnitude(l.b)) / magnitude(l.d))) {
+      break;
+    }
+    std::tie(l.a, l.c) = std::make_tuple(l.c, l.a - q * l.c);
+    std::tie(l.b, l.d) = std::make_tuple(l.d, l.b - q * l.d);
+    std::tie(u, v) = std::make_tuple(v, u - q * v);
+    l.steps++;
+  }
+  if (l.b == 0) {
+    return false;
+  }
+
+  y.number.resize(n);
+  auto combine = [&](big_integer& r, sdlimb_t p, sdlimb_t q) {
+    r.number.resize(n);
+    if (q <= 0) {
+      mul_sub_limbs(r.number.data(), x.number.data(), (limb_t) p, y.number.data(), (limb_t) -q, n);
+    } else {
+      mul_sub_limbs(r.number.data(), y.number.data(), (limb_t) q, x.number.data(), (limb_t) -p, n);
+    }
+    r.sign = false;
+    cut_leading_zero(r);
+  };
+  combine(t, l.a, l.b);
+  combine(w, l.c, l.d);
+  cut_leading_zero(y);
+  if (w.number.size() < min_size ||
+      (min_size != 0 && difference_size(t.number.data(), t.number.size(), w.number.data(), w.number.size()) < min_size)) {
+    return false;
+  }
+  x.swap(t);
+  y.swap(w);
+  return true;
+}
+
+// one batch of Lehmer steps or a single Euclid step on a > b, if b and a - b
+// keep more than s limbs (Jebelean's condition, the steps on the leading
+// limbs are then those of the whole numbers)
+bool big_integer::hgcd_step(big_integer& a, big_integer& b, size_t s, gcd_matrix& m,
+                            big_integer& t, big_integer& w) {
+  lehmer_matrix l;
+  if (lehmer_step(a, b, s + 1, l, t, w)) {
+    m.lehmer(l);
+    return true;
+  }
+  auto qr = divmod(a, b);
+  if (qr.second.number.size() <= s ||
+      difference_size(b.number.data(), b.number.size(), qr.second.number.data(), qr.second.number.size()) <= s) {
+    return false;
+  }
+  a.swap(b);
+  b.swap(qr.second);
+  m.step(qr.first.number);
+  return true;
+}
+
+// Euclid steps on a > b of n limbs for as long as b keeps more than
+// n / 2 + 1 limbs, m takes the reduced numbers back to the inputs. The
+// quotients of the leading halves are quotients of the whole numbers
+// while the remainders stay above the size of the cofactors, so both
+// halves of the work are recursive calls on the leading limbs
+bool big_integer::hgcd(big_integer& a, big_integer& b, gcd_matrix& m) {
+  size_t n = a.number.size();
+  size_t s = n / 2 + 1;
+  if (b.number.size() <= s) {
+    return false;
+  }
+  bool progress = false;
+  big_integer t, w;
+  if (n >= HGCD_THRESHOLD) {
+    progress = hgcd_top(a, b, n / 2, m);
+    while (a.number.size() > 3 * n / 4 + 1) {
+      if (!hgcd_step(a, b, s, m, t, w)) {
+        return progress;
+      }
+      progress = true;
+    }
+    size_t an = a.number.size();
+    if (an > s + 2) {
+      // the second call leaves its numbers above an - s limbs, that is
+      // above s + 1 limbs of the whole numbers
+      gcd_matrix m2;
+      if (hgcd_top(a, b, 2 * s - an + 1, m2)) {
+        m.mul(m2);
+        progress = true;
+      }
+    }
+  }
+  while (hgcd_step(a, b, s, m, t, w)) {
+    progress = true;
+  }
+  return progress;
+}
+
+// hgcd on the limbs of a and b from p up, the matrix is then applied to the
+// low limbs: (a, b) = (a', b') BASE^p + M^-1 (a_low, b_low)
+bool big_integer::hgcd_top(big_integer& a, big_integer& b, size_t p, gcd_matrix& m) {
+  big_integer ah = limbs_slice(a, p, a.number.size());
+  big_integer bh = limbs_slice(b, p, b.number.size());
+  if (bh.is_zero() || cmp_limbs(ah.number.data(), ah.number.size(), bh.number.data(), bh.number.size()) <= 0) {
+    return false;
+  }
+  if (!hgcd(ah, bh, m)) {
+    return false;
+  }
+  m.apply_inverse(ah, m.m11, a.number.data(), m.m01, b.number.data(), p);
+  m.apply_inverse(bh, m.m00, b.number.data(), m.m10, a.number.data(), p);
+  // the steps keep both a' and b' and their difference above s limbs, so
+  // the quotients are those of the whole numbers and a > b > 0 still holds
+  a.swap(ah);
+  b.swap(bh);
+  return true;
+}
+
+// gcd of |x| and |y|; with s given also s with s x = g mod y
+big_integer big_integer::gcd_abs(big_integer x, big_integer y, big_integer* s) {
+  x.sign = false;
+  y.sign = false;
+  gcd_cofactors c;
+  c.s0.push_back(1);
+  if (cmp_limbs(x.number.data(), x.number.size(), y.number.data(), y.number.size()) < 0) {
+    x.swap(y);
+    std::swap(c.s0, c.s1);
+    c.s0_negative = true;
+  }
+  gcd_cofactors* cp = (s != nullptr ? &c : nullptr);
+  big_integer t, w;
+  lehmer_matrix l;
+  while (y.number.size() > 1) {
+    if (y.number.size() >= GCD_HGCD_THRESHOLD) {
+      gcd_matrix m;
+      if (hgcd(x, y, m)) {
+        if (cp != nullptr) {
+          cp->hgcd(m);
+        }
+        continue;
+      }
+    }
+    if (lehmer_step(x, y, 0, l, t, w)) {
+      if (cp != nullptr) {
+        cp->lehmer(l);
+      }
+    } else {
+      euclid_step(x, y, cp);
+    }
+  }
+  if (s == nullptr) {
+    if (y.is_zero()) {
+      return x;
+    }
+    limb_t u = y.number[0];
+    limb_t v = divrem_long_short(x, u).second;
+    while (v != 0) {
+      u %= v;
+      std::swap(u, v);
+    }
+    return big_integer(u);
+  }
+  while (!y.is_zero()) {
+    euclid_step(x, y, &c);
+  }
+  s->number = std::move(c.s0);
+  s->sign = c.s0_negative && !s->number.empty();
+  return x;
+}
+
+big_integer gcd(big_integer const& a, big_integer const& b) {
+  return big_integer::gcd_abs(a, b, nullptr);
+}
+
+std::tuple<big_integer, big_integer, big_integer> gcdext(big_integer const& a, big_integer const& b) {
+  big_integer s;
+  big_integer g = big_integer::gcd_abs(a, b, &s);
+  big_integer t;
+  if (g.is_zero()) {
+    s.number.clear();
+    s.sign = false;
+  } else if (!b.is_zero()) {
+    // exact, g - s |a| is a multiple of |b|
+    big_integer rest = g - s * a * (a.sign ? -1 : 1);
+    t = divmod(rest, b).first;
+  }
+  if (a.sign) {
+    s = -std::move(s);
+  }
+  return {g, s, t};
+}
+
+big_integer invert(big_integer const& a, big_integer const& mod) {
+  if (mod.is_zero()) {
+    throw std::runtime_error("Division by zero");
+  }
+  big_integer m = mod;
+  m.sign = false;
+  big_integer x = a % m;
+  if (x.sign) {
+    x += m;
+  }
+  big_integer s;
+  if (big_integer::gcd_abs(x, m, &s) != 1) {
+    throw std::invalid_argument("Not invertible");
+  }
+  if (s.sign) {
+    s += m;
+  }
+  return s % m;
+}
+
+// roots: the root of the leading bits, shifted into place, is at most
+// 2^h above the root, and Newton steps from above double the precision
+
+namespace {
+
+// x^k <= v
+bool pow_fits(uint64_t x, unsigned k, uint64_t v) {
+  uint64_t p = 1;
+  for (unsigned i = 0; i < k; i++) {
+    if (x != 0 && p > v / x) {
+      return false;
+    }
+    p *= x;
+  }
+  return true;
+}
+
+// floor(v^(1/k)) for k < 64
+uint64_t iroot_u64(uint64_t v, unsigned k) {
+  uint64_t r = (uint64_t) std::pow((double) v, 1.0 / k);
+  while (r > 0 && !pow_fits(r, k, v)) {
+    r--;
+  }
+  while (pow_fits(r + 1, k, v)) {
+    r++;
+  }
+  return r;
+}
+
+big_integer pow_ui(big_integer const& x, unsigned e) {
+  big_integer res = 1;
+  for (int i = 31; i >= 0; i--) {
+    res = sqr(res);
+    if (e >> i & 1) {
+      res *= x;
+    }
+  }
+  return res;
+}
 
-uint32_t big_integer::get_pos(big_integer const& a, size_t pos) {
-  if (!a.sign) {
-    if (pos < a.number.size())
-      return a.number[pos];
-    else
-      return 0;
-  } else {
-    if (pos < a.number.size())
-      return ~(a.number[pos]);
-    else
-      return UINT32_MAX;
+} // namespace
+
+uint64_t big_integer::low_u64() const {
+  uint64_t res = 0;
+  for (size_t i = std::min(number.size(), 8 / sizeof(limb_t)); i > 0; i--) {
+    res = (res << (LIMB_BITS - 1) << 1) | number[i - 1];
   }
+  return res;
 }
 
-big_integer big_integer::bit_operation(big_integer const& a, big_integer const& b,
-                                        uint32_t(*oper)(uint32_t, uint32_t)) {
-  size_t max_size = std::max(a.number.size(), b.number.size());
-  big_integer x = a;
-  if (x.sign) {
-    ++x;
-    x.sign = true;
+big_integer isqrt(big_integer const& a) {
+  if (a.sign) {
+    throw std::invalid_argument("Square root of a negative number");
   }
-  big_integer y = b;
-  if (y.sign) {
-    ++y;
-    y.sign = true;
+  size_t n = a.bit_length();
+  if (n <= 64) {
+    return big_integer((unsigned long long) iroot_u64(a.low_u64(), 2));
   }
+  int h = (int) (n / 4);
+  big_integer x = (isqrt(a >> 2 * h) + 1) << h;
+  x = (x + a / x) >> 1;
+  // x is now at most a few units above the root
+  big_integer r = a - sqr(x);
+  while (r.sign) {
+    r += (x << 1) - 1;
+    x -= 1;
+  }
+  return x;
+}
 
-  number.resize(max_size);
-  for (size_t i = 0; i < max_size; i++) {
-    number[i] = oper(get_pos(x, i), get_pos(y, i));
+big_integer iroot(big_integer const& a, unsigned k) {
+  if (k == 0) {
+    throw std::invalid_argument("Root of degree zero");
   }
-  sign = oper(x.sign, y.sign);
-  if (sign) {
-    for (size_t i = 0; i < max_size; i++) {
-      number[i] = ~number[i];
+  if (a.sign) {
+    if (k % 2 == 0) {
+      throw std::invalid_argument("Even root of a negative number");
+    }
+    return -iroot(-a, k);
+  }
+  if (k == 1) {
+    return a;
+  }
+  if (k == 2) {
+    return isqrt(a);
+  }
+  size_t n = a.bit_length();
+  if (n <= k) {
+    return a.is_zero() ? 0 : 1;
+  }
+  if (n <= 64) {
+    return big_integer((unsigned long long) iroot_u64(a.low_u64(), k));
+  }
+  int h = (int) (n / (2 * k));
+  big_integer x;
+  if (h == 0) {
+    x = big_integer(1) << (int) ((n + k - 1) / k);
+  } else {
+    x = (iroot(a >> (int) (k * h), k) + 1) << h;
+  }
+  for (;;) {
+    big_integer y = (x * (k - 1) + a / pow_ui(x, k - 1)) / k;
+    if (y >= x) {
+      return x;
+    }
+    x.swap(y);
+  }
+}
+
+// negative numbers take part in two's complement, ~m + 1 for a magnitude m:
+// the +1 carries through the low zero limbs of m, so every limb is converted
+// on the fly while the carry is kept, and the same is done for the result
+
+void big_integer::bit_operation(big_integer const& rhs, limb_t (*oper)(limb_t, limb_t)) {
+  size_t an = number.size();
+  size_t bn = rhs.number.size();
+  bool a_neg = sign && an != 0;
+  bool b_neg = rhs.sign && bn != 0;
+  bool r_neg = oper(a_neg ? LIMB_MAX : 0, b_neg ? LIMB_MAX : 0) != 0;
+  // one more limb for the sign extension, -BASE^n needs n + 1 limbs
+  size_t n = std::max(an, bn) + 1;
+  number.resize(n);
+  limb_t* r = number.data();
+  limb_t const* b = rhs.number.data();
+  limb_t a_carry = a_neg;
+  limb_t b_carry = b_neg;
+  limb_t r_carry = r_neg;
+  for (size_t i = 0; i < n; i++) {
+    limb_t x = (i < an ? r[i] : 0);
+    limb_t y = (i < bn ? b[i] : 0);
+    if (a_neg) {
+      x = ~x + a_carry;
+      a_carry &= (x == 0);
+    }
+    if (b_neg) {
+      y = ~y + b_carry;
+      b_carry &= (y == 0);
+    }
+    limb_t z = oper(x, y);
+    if (r_neg) {
+      z = ~z + r_carry;
+      r_carry &= (z == 0);
     }
-    --(*this);
+    r[i] = z;
   }
+  sign = r_neg;
   cut_leading_zero(*this);
-  return *this;
 }
 
 big_integer& big_integer::operator&=(big_integer const& rhs) {
-  return *this = bit_operation(*this, rhs, [](uint32_t a, uint32_t b)->uint32_t{
+  bit_operation(rhs, [](limb_t a, limb_t b) -> limb_t {
     return a & b;
   });
+  return *this;
 }
 
 big_integer& big_integer::operator|=(big_integer const& rhs) {
-  return *this = bit_operation(*this, rhs, [](uint32_t a, uint32_t b)->uint32_t{
+  bit_operation(rhs, [](limb_t a, limb_t b) -> limb_t {
     return a | b;
   });
+  return *this;
 }
 
 big_integer& big_integer::operator^=(big_integer const& rhs) {
-  return *this = bit_operation(*this, rhs, [](uint32_t a, uint32_t b)->uint32_t{
+  bit_operation(rhs, [](limb_t a, limb_t b) -> limb_t {
     return a ^ b;
   });
+  return *this;
+}
+
+big_integer andnot(big_integer a, big_integer const& b) {
+  a.bit_operation(b, [](limb_t x, limb_t y) -> limb_t {
+    return x & ~y;
+  });
+  return a;
+}
+
+// bit i of ~m + 1 is bit i of ~m, unless every lower bit of m is zero and
+// the +1 reaches it
+
+bool big_integer::test_bit(size_t i) const {
+  size_t w = i / LIMB_BITS;
+  if (w >= number.size()) {
+    return sign && !is_zero();
+  }
+  limb_t x = number[w];
+  if (sign) {
+    bool low_zero = std::all_of(number.begin(), number.begin() + w, [](limb_t y) { return y == 0; });
+    x = (low_zero ? ~x + 1 : ~x);
+  }
+  return (x >> (i % LIMB_BITS)) & 1;
+}
+
+// |*this| += 2^i
+void big_integer::add_abs_bit(size_t i) {
+  size_t w = i / LIMB_BITS;
+  limb_t bit = (limb_t) 1 << (i % LIMB_BITS);
+  size_t n = std::max(number.size(), w + 1) + 1;
+  number.resize(n);
+  add_limbs(number.data() + w, number.data() + w, n - w, &bit, 1);
+  cut_leading_zero(*this);
+}
+
+// |*this| -= 2^i, requires |*this| >= 2^i
+void big_integer::sub_abs_bit(size_t i) {
+  size_t w = i / LIMB_BITS;
+  limb_t bit = (limb_t) 1 << (i % LIMB_BITS);
+  sub_limbs(number.data() + w, number.data() + w, number.size() - w, &bit, 1);
+  cut_leading_zero(*this);
+}
+
+// for a negative number setting a zero bit adds 2^i to the value and
+// clearing a one bit subtracts it, which moves the magnitude the other way
+
+big_integer& big_integer::set_bit(size_t i) {
+  if (test_bit(i)) {
+    return *this;
+  }
+  if (sign && !is_zero()) {
+    sub_abs_bit(i);
+  } else {
+    sign = false;
+    add_abs_bit(i);
+  }
+  return *this;
+}
+
+big_integer& big_integer::clear_bit(size_t i) {
+  if (!test_bit(i)) {
+    return *this;
+  }
+  if (sign) {
+    add_abs_bit(i);
+  } else {
+    sub_abs_bit(i);
+  }
+  return *this;
+}
+
+size_t big_integer::bit_length() const {
+  if (is_zero()) {
+    return 0;
+  }
+  size_t res = (number.size() - 1) * LIMB_BITS;
+  for (limb_t top = number.back(); top != 0; top >>= 1) {
+    res++;
+  }
+  return res;
+}
+
+size_t big_integer::popcount() const {
+  if (sign && !is_zero()) {
+    return SIZE_MAX;
+  }
+  size_t res = 0;
+  for (limb_t x : number) {
+    res += std::bitset<LIMB_BITS>(x).count();
+  }
+  return res;
 }
 
 big_integer& big_integer::operator<<=(int rhs) {
-  int full_bits = rhs / 32;
-  int shift = rhs % 32;
-  *this *= (1Ull << shift);
-  for (size_t i = 0; i < full_bits; i++) {
-    number.insert(number.begin(), 0);
+  if (is_zero()) {
+    return *this;
+  }
+  size_t words = rhs / LIMB_BITS;
+  int bits = rhs % LIMB_BITS;
+  size_t n = number.size();
+  number.resize(n + words + 1);
+  limb_t* p = number.data();
+  if (bits == 0) {
+    std::copy_backward(p, p + n, p + n + words);
+  } else {
+    p[n + words] = lshift_limbs(p + words, p, n, bits);
   }
+  std::fill(p, p + words, 0);
   cut_leading_zero(*this);
   return *this;
 }
 
+// rounds towards negative infinity, like the shift of a negative int
+
 big_integer& big_integer::operator>>=(int rhs) {
-  int full_bits = rhs / 32;
-  for (size_t i = 0; i < full_bits && !number.empty(); i++) {
-    number.erase(number.begin());
-  }
-  if (number.empty()) {
-    *this = 0;
+  size_t words = rhs / LIMB_BITS;
+  int bits = rhs % LIMB_BITS;
+  size_t n = number.size();
+  if (words >= n) {
+    bool negative = sign && !is_zero();
+    number.clear();
+    sign = false;
+    return negative ? --(*this) : *this;
   }
-  int shift = rhs % 32;
-  *this /= (1ULL << shift);
-  if (sign) {
-    --(*this);
+  limb_t* p = number.data();
+  bool lost = std::any_of(p, p + words, [](limb_t x) { return x != 0; });
+  if (bits == 0) {
+    std::copy(p + words, p + n, p);
+  } else {
+    lost |= (rshift_limbs(p, p + words, n - words, bits) != 0);
   }
+  number.resize(n - words);
   cut_leading_zero(*this);
+  if (sign && lost) {
+    increment_abs();
+  }
   return *this;
 }
 
-big_integer big_integer::operator+() const {
+big_integer big_integer::operator+() const& {
   return *this;
 }
 
-big_integer big_integer::operator-() const {
+big_integer big_integer::operator+() && {
+  return std::move(*this);
+}
+
+big_integer big_integer::operator-() const& {
   big_integer res(*this);
   res.sign = !res.sign;
   return res;
 }
 
+big_integer big_integer::operator-() && {
+  sign = !sign;
+  return std::move(*this);
+}
+
 big_integer big_integer::operator~() const {
   return -(*this) - 1;
 }
 
+void big_integer::increment_abs() {
+  for (limb_t& x : number) {
+    if (++x != 0) {
+      return;
+    }
+  }
+  number.push_back(1);
+}
+
+void big_integer::decrement_abs() {
+  for (limb_t& x : number) {
+    if (x-- != 0) {
+      break;
+    }
+  }
+  cut_leading_zero(*this);
+}
+
 big_integer& big_integer::operator++() {
-  return (*this += 1);
+  if (sign && !number.empty()) {
+    decrement_abs();
+    sign = !number.empty();
+  } else {
+    increment_abs();
+    sign = false;
+  }
+  return *this;
 }
 
 big_integer big_integer::operator++(int) {
@@ -427,7 +2984,13 @@ big_integer big_integer::operator++(int) {
 }
 
 big_integer& big_integer::operator--() {
-  return (*this -= 1);
+  if (!sign && !number.empty()) {
+    decrement_abs();
+  } else {
+    increment_abs();
+    sign = true;
+  }
+  return *this;
 }
 
 big_integer big_integer::operator--(int) {
@@ -436,44 +2999,177 @@ big_integer big_integer::operator--(int) {
   return copy;
 }
 
-big_integer operator+(big_integer a, big_integer const& b) {
-  return a += b;
+big_integer operator+(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res += b;
+  return res;
+}
+
+big_integer operator+(big_integer&& a, big_integer const& b) {
+  a += b;
+  return std::move(a);
+}
+
+big_integer operator+(big_integer const& a, big_integer&& b) {
+  b += a;
+  return std::move(b);
+}
+
+big_integer operator+(big_integer&& a, big_integer&& b) {
+  a += b;
+  return std::move(a);
+}
+
+big_integer operator-(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res -= b;
+  return res;
+}
+
+big_integer operator-(big_integer&& a, big_integer const& b) {
+  a -= b;
+  return std::move(a);
+}
+
+big_integer operator-(big_integer const& a, big_integer&& b) {
+  b -= a;
+  return -std::move(b);
+}
+
+big_integer operator-(big_integer&& a, big_integer&& b) {
+  a -= b;
+  return std::move(a);
+}
+
+big_integer operator*(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res *= b;
+  return res;
+}
+
+big_integer operator*(big_integer&& a, big_integer const& b) {
+  a *= b;
+  return std::move(a);
+}
+
+big_integer operator*(big_integer const& a, big_integer&& b) {
+  b *= a;
+  return std::move(b);
+}
+
+big_integer operator*(big_integer&& a, big_integer&& b) {
+  a *= b;
+  return std::move(a);
+}
+
+big_integer operator/(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res /= b;
+  return res;
+}
+
+big_integer operator/(big_integer&& a, big_integer const& b) {
+  a /= b;
+  return std::move(a);
+}
+
+big_integer operator%(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res %= b;
+  return res;
+}
+
+big_integer operator%(big_integer&& a, big_integer const& b) {
+  a %= b;
+  return std::move(a);
+}
+
+big_integer operator/(big_integer a, big_reciprocal const& b) {
+  a /= b;
+  return a;
+}
+
+big_integer operator%(big_integer a, big_reciprocal const& b) {
+  a %= b;
+  return a;
+}
+
+big_integer operator%(big_integer a, barrett_reducer const& b) {
+  a %= b;
+  return a;
+}
+
+big_integer operator&(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res &= b;
+  return res;
+}
+
+big_integer operator&(big_integer&& a, big_integer const& b) {
+  a &= b;
+  return std::move(a);
+}
+
+big_integer operator&(big_integer const& a, big_integer&& b) {
+  b &= a;
+  return std::move(b);
+}
+
+big_integer operator&(big_integer&& a, big_integer&& b) {
+  a &= b;
+  return std::move(a);
+}
+
+big_integer operator|(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res |= b;
+  return res;
 }
 
-big_integer operator-(big_integer a, big_integer const& b) {
-  return a -= b;
+big_integer operator|(big_integer&& a, big_integer const& b) {
+  a |= b;
+  return std::move(a);
 }
 
-big_integer operator*(big_integer a, big_integer const& b) {
-  return a *= b;
+big_integer operator|(big_integer const& a, big_integer&& b) {
+  b |= a;
+  return std::move(b);
 }
 
-big_integer operator/(big_integer a, big_integer const& b) {
-  return a /= b;
+big_integer operator|(big_integer&& a, big_integer&& b) {
+  a |= b;
+  return std::move(a);
 }
 
-big_integer operator%(big_integer a, big_integer const& b) {
-  return a %= b;
+big_integer operator^(big_integer const& a, big_integer const& b) {
+  big_integer res(a);
+  res ^= b;
+  return res;
 }
 
-big_integer operator&(big_integer a, big_integer const& b) {
-  return a &= b;
+big_integer operator^(big_integer&& a, big_integer const& b) {
+  a ^= b;
+  return std::move(a);
 }
 
-big_integer operator|(big_integer a, big_integer const& b) {
-  return a |= b;
+big_integer operator^(big_integer const& a, big_integer&& b) {
+  b ^= a;
+  return std::move(b);
 }
 
-big_integer operator^(big_integer a, big_integer const& b) {
-  return a ^= b;
+big_integer operator^(big_integer&& a, big_integer&& b) {
+  a ^= b;
+  return std::move(a);
 }
 
 big_integer operator<<(big_integer a, int b) {
-  return a <<= b;
+  a <<= b;
+  return a;
 }
 
 big_integer operator>>(big_integer a, int b) {
-  return a >>= b;
+  a >>= b;
+  return a;
 }
 
 bool operator==(big_integer const& a, big_integer const& b) {
@@ -514,30 +3210,376 @@ bool operator>=(big_integer const& a, big_integer const& b) {
   return !(a < b);
 }
 
+// below this many limbs digits are peeled off 9 at a time
+
+static const size_t TO_STRING_THRESHOLD = 160 / sizeof(limb_t);
+
+// writes exactly 9 * 2^k digits of |x| < powers[k], with leading zeros
+
+void big_integer::write_decimal(big_integer const& x, size_t k, char* out, decimal_powers& powers) {
+  size_t width = 9 * ((size_t) 1 << k);
+  if (x.number.size() <= TO_STRING_THRESHOLD) {
+    limb_vector rest = x.number;
+    char* pos = out + width;
+    while (!rest.empty()) {
+      uint32_t rem = divrem_small(rest.data(), rest.size(), DIGIT_BASE);
+      while (!rest.empty() && rest.back() == 0) {
+        rest.pop_back();
+      }
+      for (size_t i = 0; i < 9; i++) {
+        *--pos = (char) ('0' + rem % 10);
+        rem /= 10;
+      }
+    }
+    std::fill(out, pos, '0');
+    return;
+  }
+  auto qr = divide_abs(x, powers[k - 1]);
+  write_decimal(qr.first, k - 1, out, powers);
+  write_decimal(qr.second, k - 1, out + width / 2, powers);
+}
+
+// up to this many digits are parsed 9 at a time into a single buffer
+
+static const size_t PARSE_THRESHOLD = 360;
+
+// digits.size() <= 9 * 2^k, the high part is scaled by powers[k - 1]
+
+big_integer big_integer::parse_decimal(std::string_view digits, size_t k, decimal_powers& powers) {
+  if (digits.size() <= PARSE_THRESHOLD) {
+    big_integer res;
+    size_t pos = 0;
+    while (pos < digits.size()) {
+      size_t len = (pos == 0 && digits.size() % 9 != 0 ? digits.size() % 9 : 9);
+      limb_t block = 0;
+      limb_t scale = 1;
+      for (size_t i = 0; i < len; i++) {
+        block = block * 10 + (digits[pos + i] - '0');
+        scale *= 10;
+      }
+      pos += len;
+      limb_t carry = mul_1(res.number.data(), res.number.data(), res.number.size(), scale);
+      if (carry != 0) {
+        res.number.push_back(carry);
+      }
+      if (block != 0) {
+        res.number.push_back(0);
+        limb_t b[] = {block};
+        add_limbs(res.number.data(), res.number.data(), res.number.size(), b, 1);
+      }
+      cut_leading_zero(res);
+    }
+    return res;
+  }
+  size_t half = 9 * ((size_t) 1 << (k - 1));
+  if (digits.size() <= half) {
+    return parse_decimal(digits, k - 1, powers);
+  }
+  big_integer res = parse_decimal(digits.substr(0, digits.size() - half), k - 1, powers);
+  res *= powers[k - 1];
+  res += parse_decimal(digits.substr(digits.size() - half), k - 1, powers);
+  return res;
+}
+
 std::string to_string(big_integer const& a) {
-  std::string ans = "";
   if (a.is_zero()) {
     return "0";
   }
-  big_integer temp = a;
-  while (!temp.is_zero()) {
-    big_integer mod = temp % DIGIT_BASE;
-    uint32_t digit_mod = (!mod.is_zero() ? mod.number[0] : 0);
-    for (size_t i = 0; i < 9; i++) {
-      ans = (char) ((digit_mod % 10) + '0') + ans;
-      digit_mod /= 10;
+  big_integer::decimal_powers powers;
+  size_t k = 0;
+  if (a.number.size() <= TO_STRING_THRESHOLD) {
+    // without the powers and on the stack: 9 * 2^k digits hold 29 * 2^k bits
+    static_assert(TO_STRING_THRESHOLD * LIMB_BITS <= 29 * 64);
+    char buffer[1 + 9 * 64];
+    while (((size_t) 29 << k) < a.bit_length()) {
+      k++;
+    }
+    char* end = buffer + 1 + 9 * ((size_t) 1 << k);
+    big_integer::write_decimal(a, k, buffer + 1, powers);
+    char* first = std::find_if(buffer + 1, end - 1, [](char c) { return c != '0'; });
+    if (a.sign) {
+      *--first = '-';
     }
-    temp = temp.divide_long_short(temp, DIGIT_BASE);
+    return std::string(first, end);
   }
-  while (ans[0] == '0') {
-    ans.erase(ans.begin());
+  while (!(cmp_limbs(a.number.data(), a.number.size(), powers[k].number.data(), powers[k].number.size()) < 0)) {
+    k++;
   }
+  // one spare char in front for the sign
+  std::string ans(9 * ((size_t) 1 << k) + 1, '0');
+  big_integer::write_decimal(a, k, &ans[1], powers);
+  size_t first = ans.find_first_not_of('0');
   if (a.sign) {
-    ans = '-' + ans;
+    ans[--first] = '-';
   }
-  return ans;
+  return ans.substr(first);
+}
+
+// streams go through chunks of 9 * 2^STREAM_LEVEL digits
+
+static const size_t STREAM_LEVEL = 10;
+
+// |x| < powers[k], with leading zeros to 9 * 2^k digits when pad
+
+void big_integer::stream_decimal(std::ostream& s, big_integer const& x, size_t k, bool pad,
+                                 decimal_powers& powers) {
+  if (k <= STREAM_LEVEL) {
+    std::string chunk(9 * ((size_t) 1 << k), '0');
+    write_decimal(x, k, &chunk[0], powers);
+    size_t first = (pad ? 0 : std::min(chunk.find_first_not_of('0'), chunk.size() - 1));
+    s.write(chunk.data() + first, (std::streamsize) (chunk.size() - first));
+    return;
+  }
+  big_integer const& p = powers[k - 1];
+  if (!pad && cmp_limbs(x.number.data(), x.number.size(), p.number.data(), p.number.size()) < 0) {
+    stream_decimal(s, x, k - 1, false, powers);
+    return;
+  }
+  auto qr = divide_abs(x, p);
+  stream_decimal(s, qr.first, k - 1, pad, powers);
+  qr.first = big_integer();
+  stream_decimal(s, qr.second, k - 1, true, powers);
 }
 
 std::ostream& operator<<(std::ostream& s, big_integer const& a) {
-  return s << to_string(a);
+  if (s.width() != 0 || a.number.size() <= TO_STRING_THRESHOLD) {
+    return s << to_string(a);
+  }
+  big_integer::decimal_powers powers;
+  big_integer const& chunk = powers[STREAM_LEVEL];
+  if (cmp_limbs(a.number.data(), a.number.size(), chunk.number.data(), chunk.number.size()) < 0) {
+    return s << to_string(a);
+  }
+  size_t k = STREAM_LEVEL;
+  while (!(cmp_limbs(a.number.data(), a.number.size(), powers[k].number.data(), powers[k].number.size()) < 0)) {
+    k++;
+  }
+  if (a.sign) {
+    s.put('-');
+  }
+  big_integer::stream_decimal(s, a, k, false, powers);
+  return s;
+}
+
+// full chunks are parsed as they arrive and merged like a binary counter:
+// two parts of 9 * 2^k digits make one of 9 * 2^(k + 1)
+
+std::istream& operator>>(std::istream& s, big_integer& a) {
+  std::istream::sentry sentry(s);
+  if (!sentry) {
+    return s;
+  }
+  std::streambuf* buf = s.rdbuf();
+  int c = buf->sgetc();
+  bool is_neg = (c == '-');
+  if (is_neg) {
+    c = buf->snextc();
+  }
+  size_t width = 9 * ((size_t) 1 << STREAM_LEVEL);
+  std::string chunk;
+  chunk.reserve(width);
+  std::vector<std::pair<big_integer, size_t>> parts;
+  big_integer::decimal_powers powers;
+  bool any = false;
+  while (c != std::char_traits<char>::eof() && '0' <= c && c <= '9') {
+    any = true;
+    chunk.push_back((char) c);
+    if (chunk.size() == width) {
+      big_integer part = big_integer::parse_decimal(chunk, STREAM_LEVEL, powers);
+      size_t k = STREAM_LEVEL;
+      while (!parts.empty() && parts.back().second == k) {
+        part += parts.back().first * powers[k];
+        parts.pop_back();
+        k++;
+      }
+      parts.emplace_back(std::move(part), k);
+      chunk.clear();
+    }
+    c = buf->snextc();
+  }
+  if (c == std::char_traits<char>::eof()) {
+    s.setstate(std::ios_base::eofbit);
+  }
+  if (!any) {
+    s.setstate(std::ios_base::failbit);
+    return s;
+  }
+  big_integer res = big_integer::parse_decimal(chunk, STREAM_LEVEL, powers);
+  big_integer scale = pow_ui(10, (unsigned) chunk.size());
+  while (!parts.empty()) {
+    res += parts.back().first * scale;
+    if (parts.size() > 1) {
+      scale *= powers[parts.back().second];
+    }
+    parts.pop_back();
+  }
+  res.sign = is_neg && !res.is_zero();
+  a.swap(res);
+  return s;
+}
+
+// power-of-two bases: digit i is the bit field at i k of the magnitude
+
+namespace {
+
+// bits per digit, 0 for base 10
+int radix_bits(int base) {
+  switch (base) {
+  case 2:
+    return 1;
+  case 8:
+    return 3;
+  case 16:
+    return 4;
+  case 32:
+    return 5;
+  case 10:
+    return 0;
+  default:
+    throw std::invalid_argument("Unsupported base");
+  }
+}
+
+int digit_value(char c) {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  }
+  if ('a' <= c && c <= 'z') {
+    return c - 'a' + 10;
+  }
+  if ('A' <= c && c <= 'Z') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+} // namespace
+
+big_integer::big_integer(std::string const& str, int base) : big_integer() {
+  int k = radix_bits(base);
+  if (k == 0) {
+    big_integer(str).swap(*this);
+    return;
+  }
+  std::string_view digits = str;
+  bool is_neg = !digits.empty() && digits[0] == '-';
+  if (is_neg) {
+    digits.remove_prefix(1);
+  }
+  if (digits.empty()) {
+    throw std::invalid_argument("Invalid number");
+  }
+  number.resize((digits.size() * k + LIMB_BITS - 1) / LIMB_BITS);
+  size_t pos = 0;
+  for (size_t i = digits.size(); i > 0; i--, pos += k) {
+    int d = digit_value(digits[i - 1]);
+    if (d < 0 || d >= base) {
+      throw std::invalid_argument("Invalid number");
+    }
+    size_t j = pos / LIMB_BITS;
+    int sh = (int) (pos % LIMB_BITS);
+    number[j] |= (limb_t) d << sh;
+    if (sh + k > LIMB_BITS) {
+      number[j + 1] |= (limb_t) d >> (LIMB_BITS - sh);
+    }
+  }
+  cut_leading_zero(*this);
+  sign = is_neg && !is_zero();
+}
+
+std::string to_string(big_integer const& a, int base) {
+  int k = radix_bits(base);
+  if (k == 0) {
+    return to_string(a);
+  }
+  if (a.is_zero()) {
+    return "0";
+  }
+  static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuv";
+  size_t n = (a.bit_length() + k - 1) / k;
+  std::string ans(n + a.sign, '-');
+  size_t pos = 0;
+  for (size_t i = ans.size(); i > ans.size() - n; i--, pos += k) {
+    size_t j = pos / LIMB_BITS;
+    int sh = (int) (pos % LIMB_BITS);
+    limb_t d = a.number[j] >> sh;
+    if (sh + k > LIMB_BITS && j + 1 < a.number.size()) {
+      d |= a.number[j + 1] << (LIMB_BITS - sh);
+    }
+    ans[i - 1] = DIGITS[d & (base - 1)];
+  }
+  return ans;
+}
+
+limb_span big_integer::limbs() const {
+  return limb_span(number.data(), number.size());
+}
+
+bool big_integer::is_negative() const {
+  return sign && !is_zero();
+}
+
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static const int HOST_ENDIAN = 1;
+#else
+static const int HOST_ENDIAN = -1;
+#endif
+
+void check_word_format(int order, size_t size, int endian) {
+  if ((order != 1 && order != -1) || size == 0 || endian < -1 || endian > 1) {
+    throw std::invalid_argument("Invalid word format");
+  }
+}
+
+// offset in the buffer of byte k of the number, counted from the least
+// significant one
+size_t byte_offset(size_t k, size_t count, int order, size_t size, int endian) {
+  size_t w = k / size;
+  size_t b = k % size;
+  return (order < 0 ? w : count - 1 - w) * size + (endian < 0 ? b : size - 1 - b);
+}
+
+} // namespace
+
+big_integer import_words(void const* data, size_t count, int order, size_t size, int endian) {
+  check_word_format(order, size, endian);
+  if (endian == 0) {
+    endian = HOST_ENDIAN;
+  }
+  big_integer res;
+  size_t bytes = count * size;
+  res.number.resize((bytes + sizeof(limb_t) - 1) / sizeof(limb_t));
+  if (order < 0 && endian == HOST_ENDIAN && size == sizeof(limb_t)) {
+    std::memcpy(res.number.data(), data, bytes);
+  } else {
+    auto src = static_cast<unsigned char const*>(data);
+    for (size_t k = 0; k < bytes; k++) {
+      limb_t byte = src[byte_offset(k, count, order, size, endian)];
+      res.number[k / sizeof(limb_t)] |= byte << (8 * (k % sizeof(limb_t)));
+    }
+  }
+  big_integer::cut_leading_zero(res);
+  return res;
+}
+
+size_t export_words(void* data, big_integer const& a, int order, size_t size, int endian) {
+  check_word_format(order, size, endian);
+  if (endian == 0) {
+    endian = HOST_ENDIAN;
+  }
+  size_t count = (a.bit_length() + 8 * size - 1) / (8 * size);
+  size_t bytes = count * size;
+  size_t have = a.number.size() * sizeof(limb_t);
+  if (order < 0 && endian == HOST_ENDIAN && size == sizeof(limb_t)) {
+    std::memcpy(data, a.number.data(), bytes);
+  } else {
+    auto dst = static_cast<unsigned char*>(data);
+    for (size_t k = 0; k < bytes; k++) {
+      limb_t byte = k < have ? a.number[k / sizeof(limb_t)] >> (8 * (k % sizeof(limb_t))) : 0;
+      dst[byte_offset(k, count, order, size, endian)] = (unsigned char) byte;
+    }
+  }
+  return count;
 }
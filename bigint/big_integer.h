@@ -1,12 +1,139 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
-#include <vector>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+// define BIGINT_LIMB64 to build with 64-bit limbs and 128-bit intermediate
+// products instead of 32-bit limbs, needs a compiler with unsigned __int128
+
+#ifdef BIGINT_LIMB64
+#ifndef __SIZEOF_INT128__
+#error "BIGINT_LIMB64 requires unsigned __int128"
+#endif
+typedef uint64_t limb_t;
+#else
+typedef uint32_t limb_t;
+#endif
+
+struct big_reciprocal;
+struct barrett_reducer;
+struct montgomery_context;
+
+// vector of limbs that keeps up to 128 bits inside the object and only goes
+// to the heap for larger numbers
+struct limb_vector {
+  static constexpr size_t INLINE_CAPACITY = 16 / sizeof(limb_t);
+
+  limb_vector() noexcept : size_(0), capacity_(INLINE_CAPACITY) {}
+  explicit limb_vector(size_t n);
+  limb_vector(limb_vector const& other);
+  limb_vector(limb_vector&& other) noexcept;
+  ~limb_vector();
+
+  limb_vector& operator=(limb_vector const& other);
+  limb_vector& operator=(limb_vector&& other) noexcept;
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  limb_t* data() { return capacity_ > INLINE_CAPACITY ? heap_ : inline_; }
+  limb_t const* data() const { return capacity_ > INLINE_CAPACITY ? heap_ : inline_; }
+  limb_t& operator[](size_t i) { return data()[i]; }
+  limb_t const& operator[](size_t i) const { return data()[i]; }
+  limb_t* begin() { return data(); }
+  limb_t const* begin() const { return data(); }
+  limb_t* end() { return data() + size_; }
+  limb_t const* end() const { return data() + size_; }
+  limb_t& back() { return data()[size_ - 1]; }
+  limb_t const& back() const { return data()[size_ - 1]; }
+
+  void push_back(limb_t x) {
+    if (size_ == capacity_) {
+      grow(size_ + 1);
+    }
+    data()[size_++] = x;
+  }
+  void pop_back() { size_--; }
+  void clear() { size_ = 0; }
+
+  void reserve(size_t n);
+  // new limbs are zero
+  void resize(size_t n);
+  void assign(size_t n, limb_t value);
+  void assign(limb_t const* first, limb_t const* last);
+  limb_t* insert(limb_t* pos, size_t count, limb_t value);
+  limb_t* insert(limb_t* pos, limb_t value);
+  limb_t* erase(limb_t* pos);
+
+  friend bool operator==(limb_vector const& a, limb_vector const& b);
+
+private:
+  void steal(limb_vector& other) noexcept;
+  void grow(size_t n);
+
+  size_t size_;
+  size_t capacity_;
+  union {
+    limb_t* heap_;
+    limb_t inline_[INLINE_CAPACITY];
+  };
+};
+
+// while a scratch_scope is alive, limb buffers released on its thread are
+// kept for reuse instead of going back to the heap, so a loop of operations
+// on numbers of similar size stops allocating after the first round; scopes
+// nest and the cached buffers are freed when the outermost one ends
+
+struct scratch_scope {
+  scratch_scope();
+  ~scratch_scope();
+
+  scratch_scope(scratch_scope const&) = delete;
+  scratch_scope& operator=(scratch_scope const&) = delete;
+};
+
+// read-only view of limbs, least significant first
+
+struct limb_span {
+  limb_span(limb_t const* data, size_t size) : data_(data), size_(size) {}
+
+  limb_t const* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  limb_t const& operator[](size_t i) const { return data_[i]; }
+  limb_t const* begin() const { return data_; }
+  limb_t const* end() const { return data_ + size_; }
+
+private:
+  limb_t const* data_;
+  size_t size_;
+};
+
+// add, subtract and shift kernels of the limb arithmetic; the fastest one
+// the CPU supports is used, the others are reachable for tests through
+// limb_kernel(i), i < limb_kernel_count(), with the scalar one at index 0
+
+struct limb_kernels {
+  char const* name;
+  limb_t (*add_n)(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t carry);
+  limb_t (*sub_n)(limb_t* r, limb_t const* a, limb_t const* b, size_t n, limb_t borrow);
+  limb_t (*lshift)(limb_t* r, limb_t const* a, size_t n, int bits);
+  limb_t (*rshift)(limb_t* r, limb_t const* a, size_t n, int bits);
+};
+
+size_t limb_kernel_count();
+limb_kernels const& limb_kernel(size_t i);
 
 struct big_integer {
   big_integer();
   big_integer(big_integer const& other);
+  big_integer(big_integer&& other) noexcept;
 
   big_integer(int a);
   big_integer(unsigned a);
@@ -16,9 +143,12 @@ struct big_integer {
   big_integer(unsigned long long a);
 
   explicit big_integer(std::string const& str);
+  // digits of base 2, 8, 16 or 32 (0-9 and a-v in either case), or 10
+  big_integer(std::string const& str, int base);
   ~big_integer();
 
   big_integer& operator=(big_integer const& other);
+  big_integer& operator=(big_integer&& other) noexcept;
 
   big_integer& operator+=(big_integer const& rhs);
   big_integer& operator-=(big_integer const& rhs);
@@ -26,6 +156,13 @@ struct big_integer {
   big_integer& operator/=(big_integer const& rhs);
   big_integer& operator%=(big_integer const& rhs);
 
+  // for repeated division by the same value
+  big_reciprocal reciprocal() const;
+  big_integer& operator/=(big_reciprocal const& rhs);
+  big_integer& operator%=(big_reciprocal const& rhs);
+  // for repeated reduction by the same modulus
+  big_integer& operator%=(barrett_reducer const& rhs);
+
   big_integer& operator&=(big_integer const& rhs);
   big_integer& operator|=(big_integer const& rhs);
   big_integer& operator^=(big_integer const& rhs);
@@ -33,8 +170,25 @@ struct big_integer {
   big_integer& operator<<=(int rhs);
   big_integer& operator>>=(int rhs);
 
-  big_integer operator+() const;
-  big_integer operator-() const;
+  // single bits of the two's complement representation, as for int
+  bool test_bit(size_t i) const;
+  big_integer& set_bit(size_t i);
+  big_integer& clear_bit(size_t i);
+
+  // bits in |a|, 0 for zero
+  size_t bit_length() const;
+  // one bits, SIZE_MAX for a negative number that has infinitely many
+  size_t popcount() const;
+
+  // the magnitude without leading zero limbs, valid until the number
+  // is modified
+  limb_span limbs() const;
+  bool is_negative() const;
+
+  big_integer operator+() const&;
+  big_integer operator+() &&;
+  big_integer operator-() const&;
+  big_integer operator-() &&;
   big_integer operator~() const;
 
   big_integer& operator++();
@@ -50,13 +204,31 @@ struct big_integer {
   friend bool operator<=(big_integer const& a, big_integer const& b);
   friend bool operator>=(big_integer const& a, big_integer const& b);
 
+  friend big_integer sqr(big_integer const& a);
+  friend big_integer andnot(big_integer a, big_integer const& b);
+  friend std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+  friend big_integer gcd(big_integer const& a, big_integer const& b);
+  friend std::tuple<big_integer, big_integer, big_integer> gcdext(big_integer const& a, big_integer const& b);
+  friend big_integer invert(big_integer const& a, big_integer const& mod);
+  friend big_integer isqrt(big_integer const& a);
+  friend big_integer iroot(big_integer const& a, unsigned k);
   friend std::string to_string(big_integer const& a);
+  friend std::ostream& operator<<(std::ostream& s, big_integer const& a);
+  friend std::istream& operator>>(std::istream& s, big_integer& a);
+  friend std::string to_string(big_integer const& a, int base);
+  friend big_integer import_words(void const* data, size_t count, int order, size_t size, int endian);
+  friend size_t export_words(void* data, big_integer const& a, int order, size_t size, int endian);
+  friend struct montgomery_context;
 
 private:
   void swap(big_integer &);
-  void cut_leading_zero(big_integer &);
+  static void cut_leading_zero(big_integer &);
   bool is_zero() const;
   void fill_vector(uint64_t);
+  // the low 64 bits of the magnitude
+  uint64_t low_u64() const;
+  void increment_abs();
+  void decrement_abs();
   bool comp_abs_less(big_integer const&) const;
 
   // for sum and subtract
@@ -66,39 +238,139 @@ private:
 
   // for multiply
 
-  big_integer mul_bigint_bigint(big_integer const& a, big_integer const& b);
+  static big_integer mul_bigint_bigint(big_integer const& a, big_integer const& b);
 
   // for division
 
-  std::pair<big_integer, big_integer> long_divide(big_integer const& a, big_integer const& b);
-  uint64_t trial(big_integer const& a, big_integer const& b, size_t k, size_t m);
-  bool smaller(big_integer const& r, big_integer const& dq, size_t k, size_t m);
-  big_integer divide_long_short(big_integer const &a, uint32_t b);
-  big_integer remainder_long_short(big_integer const &a, uint32_t b);
+  static std::pair<big_integer, big_integer> long_divide(big_integer const& a, big_integer const& b);
+  static big_integer divide_long_short(big_integer const &a, limb_t b);
+  static std::pair<big_integer, limb_t> divrem_long_short(big_integer const& a, limb_t b);
+  static big_integer remainder_long_short(big_integer const &a, limb_t b);
+
+  // Burnikel-Ziegler recursive division, on magnitudes
+
+  static std::pair<big_integer, big_integer> divide_abs(big_integer const& a, big_integer const& b);
+  static std::pair<big_integer, big_integer> divide_bz(big_integer const& a, big_integer const& b);
+  static std::pair<big_integer, big_integer> div_2n_1n(big_integer const& a, big_integer const& b, size_t n);
+  static std::pair<big_integer, big_integer> div_3n_2n(big_integer const& a, big_integer const& b, size_t h);
+  static big_integer limbs_slice(big_integer const& a, size_t from, size_t to);
+  static big_integer& shift_limbs(big_integer& a, size_t k);
+
+  // Newton-Raphson reciprocal division, on magnitudes
+
+  static big_integer newton_inverse(big_integer const& d);
+  static std::pair<big_integer, big_integer> divide_newton(big_integer const& a, big_integer const& d,
+                                                           big_integer const& v);
+
+  // for gcd, on magnitudes: Lehmer steps on the leading limbs and the
+  // recursive half-gcd for long numbers
+
+  struct gcd_matrix;
+  struct gcd_cofactors;
+  struct lehmer_matrix;
+
+  static big_integer gcd_abs(big_integer x, big_integer y, big_integer* s);
+  static void euclid_step(big_integer& x, big_integer& y, gcd_cofactors* c);
+  static bool lehmer_step(big_integer& x, big_integer& y, size_t s, lehmer_matrix& l,
+                          big_integer& t, big_integer& w);
+  static bool hgcd(big_integer& a, big_integer& b, gcd_matrix& m);
+  static bool hgcd_top(big_integer& a, big_integer& b, size_t p, gcd_matrix& m);
+  static bool hgcd_step(big_integer& a, big_integer& b, size_t s, gcd_matrix& m,
+                        big_integer& t, big_integer& w);
+
+  // for to_string
+
+  struct decimal_powers;
+
+  static void write_decimal(big_integer const& x, size_t k, char* out, decimal_powers& powers);
+  static big_integer parse_decimal(std::string_view digits, size_t k, decimal_powers& powers);
+  static void stream_decimal(std::ostream& s, big_integer const& x, size_t k, bool pad,
+                             decimal_powers& powers);
 
   // for bit_operations
 
-  uint32_t get_pos(big_integer const&, size_t);
-  big_integer bit_operation(big_integer const& a, big_integer const& b,
-                             uint32_t(*oper)(uint32_t, uint32_t));
+  void bit_operation(big_integer const& rhs, limb_t (*oper)(limb_t, limb_t));
+  void add_abs_bit(size_t i);
+  void sub_abs_bit(size_t i);
 
   bool sign;
-  std::vector<uint32_t> number;
+  limb_vector number;
 };
 
-big_integer operator+(big_integer a, big_integer const& b);
-big_integer operator-(big_integer a, big_integer const& b);
-big_integer operator*(big_integer a, big_integer const& b);
-big_integer operator/(big_integer a, big_integer const& b);
-big_integer operator%(big_integer a, big_integer const& b);
+// overloads taking an rvalue reuse the storage of that operand for the result
+big_integer operator+(big_integer const& a, big_integer const& b);
+big_integer operator+(big_integer&& a, big_integer const& b);
+big_integer operator+(big_integer const& a, big_integer&& b);
+big_integer operator+(big_integer&& a, big_integer&& b);
+big_integer operator-(big_integer const& a, big_integer const& b);
+big_integer operator-(big_integer&& a, big_integer const& b);
+big_integer operator-(big_integer const& a, big_integer&& b);
+big_integer operator-(big_integer&& a, big_integer&& b);
+big_integer operator*(big_integer const& a, big_integer const& b);
+big_integer operator*(big_integer&& a, big_integer const& b);
+big_integer operator*(big_integer const& a, big_integer&& b);
+big_integer operator*(big_integer&& a, big_integer&& b);
+big_integer operator/(big_integer const& a, big_integer const& b);
+big_integer operator/(big_integer&& a, big_integer const& b);
+big_integer operator%(big_integer const& a, big_integer const& b);
+big_integer operator%(big_integer&& a, big_integer const& b);
+
+// quotient and remainder from one division: rounded toward zero with the
+// remainder taking the sign of a, as / and %
+std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+// rounded toward negative infinity, the remainder takes the sign of b
+std::pair<big_integer, big_integer> divmod_floor(big_integer const& a, big_integer const& b);
+
+big_integer operator/(big_integer a, big_reciprocal const& b);
+big_integer operator%(big_integer a, big_reciprocal const& b);
+big_integer operator%(big_integer a, barrett_reducer const& b);
 
-big_integer operator&(big_integer a, big_integer const& b);
-big_integer operator|(big_integer a, big_integer const& b);
-big_integer operator^(big_integer a, big_integer const& b);
+big_integer operator&(big_integer const& a, big_integer const& b);
+big_integer operator&(big_integer&& a, big_integer const& b);
+big_integer operator&(big_integer const& a, big_integer&& b);
+big_integer operator&(big_integer&& a, big_integer&& b);
+big_integer operator|(big_integer const& a, big_integer const& b);
+big_integer operator|(big_integer&& a, big_integer const& b);
+big_integer operator|(big_integer const& a, big_integer&& b);
+big_integer operator|(big_integer&& a, big_integer&& b);
+big_integer operator^(big_integer const& a, big_integer const& b);
+big_integer operator^(big_integer&& a, big_integer const& b);
+big_integer operator^(big_integer const& a, big_integer&& b);
+big_integer operator^(big_integer&& a, big_integer&& b);
+
+// a & ~b
+big_integer andnot(big_integer a, big_integer const& b);
 
 big_integer operator<<(big_integer a, int b);
 big_integer operator>>(big_integer a, int b);
 
+big_integer sqr(big_integer const& a);
+
+// products of operands with at least min_limbs limbs each that are large
+// enough for the number-theoretic transform to run its three convolutions on
+// up to threads threads (so at most 3 are used), 0 for one per hardware
+// thread; the default is 1. Results do not depend on it
+void set_mul_threads(unsigned threads, size_t min_limbs = 1 << 13);
+// limbs of the smaller operand from which products use the number-theoretic
+// transform, 0 when it is not built in; for tests
+size_t ntt_threshold();
+
+// base^exp mod |mod| in [0, |mod|), exp >= 0
+big_integer powmod(big_integer const& base, big_integer const& exp, big_integer const& mod);
+
+// non-negative gcd, gcd(0, 0) = 0
+big_integer gcd(big_integer const& a, big_integer const& b);
+// {g, s, t} with a s + b t = g = gcd(a, b), the cofactors of the Euclidean
+// algorithm: |s| <= |b| / 2g and |t| <= |a| / 2g for non-zero |a| != |b|
+std::tuple<big_integer, big_integer, big_integer> gcdext(big_integer const& a, big_integer const& b);
+// x in [0, |mod|) with a x = 1 mod |mod|
+big_integer invert(big_integer const& a, big_integer const& mod);
+
+// floor(sqrt(a)), a >= 0
+big_integer isqrt(big_integer const& a);
+// the k-th root rounded toward zero, k > 0 and a >= 0 for even k
+big_integer iroot(big_integer const& a, unsigned k);
+
 bool operator==(big_integer const& a, big_integer const& b);
 bool operator!=(big_integer const& a, big_integer const& b);
 bool operator<(big_integer const& a, big_integer const& b);
@@ -107,4 +379,72 @@ bool operator<=(big_integer const& a, big_integer const& b);
 bool operator>=(big_integer const& a, big_integer const& b);
 
 std::string to_string(big_integer const& a);
+// base 2, 8, 16 or 32 with lowercase digits, or 10
+std::string to_string(big_integer const& a, int base);
+// long numbers are written and read in chunks of digits, without the
+// whole decimal text in memory
 std::ostream& operator<<(std::ostream& s, big_integer const& a);
+// an optional minus and decimal digits, fails without changing a when
+// there are no digits
+std::istream& operator>>(std::istream& s, big_integer& a);
+
+// binary data as in mpz_import and mpz_export: count words of size bytes,
+// order 1 for the most significant word first and -1 for the least, endian
+// 1 for the most significant byte of a word first, -1 for the least and 0
+// for the host order
+
+// a non-negative number from the words in data
+big_integer import_words(void const* data, size_t count, int order, size_t size, int endian);
+// writes |a| to data and returns the number of words, which is
+// (a.bit_length() + 8 size - 1) / (8 size), 0 for zero
+size_t export_words(void* data, big_integer const& a, int order, size_t size, int endian);
+
+// fixed-point inverse of a divisor, BASE^(2n) / |d| for a divisor of n limbs
+
+struct big_reciprocal {
+  big_integer const& divisor() const;
+
+private:
+  friend struct big_integer;
+  big_reciprocal(big_integer const& d, big_integer const& v);
+
+  big_integer d;
+  big_integer v;
+};
+
+// Barrett reduction by a modulus m of n limbs: a value below BASE^(2n),
+// such as a product of two residues, is reduced with two multiplications
+// by BASE^(2n) / |m|, larger values fall back to division by the reciprocal;
+// the sign of the result follows operator%. Buffers are taken per
+// reduction, so threads can share a reducer, and inside a scratch_scope
+// reductions do not allocate
+
+struct barrett_reducer {
+  explicit barrett_reducer(big_integer const& m);
+
+  big_integer const& modulus() const;
+
+private:
+  friend struct big_integer;
+
+  big_reciprocal rec;
+};
+
+// Montgomery representation modulo an odd m: products are reduced by m
+// without division, keep the context to exponentiate many times by the
+// same modulus
+
+struct montgomery_context {
+  explicit montgomery_context(big_integer const& m);
+
+  big_integer const& modulus() const;
+  // base^exp mod m in [0, m), exp >= 0
+  big_integer pow(big_integer const& base, big_integer const& exp) const;
+
+private:
+  big_integer m;
+  // BASE^(2n) mod m, converts into the Montgomery form
+  big_integer r2;
+  // -1 / m mod BASE
+  limb_t m_inv;
+};
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include <gmp.h>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../big_integer.h"
+
+namespace {
+std::string to_std_string(mpz_t const x) {
+  std::unique_ptr<char, void (*)(void*)> str(mpz_get_str(nullptr, 10, x), free);
+  return str.get();
+}
+
+// GMP's cofactors are the ones of the remainder sequence as well:
+// |s| <= b / 2g and |t| <= a / 2g
+void check_gcdext(mpz_t const a, mpz_t const b) {
+  mpz_t g, s, t;
+  mpz_inits(g, s, t, nullptr);
+  mpz_gcdext(g, s, t, a, b);
+  auto [bg, bs, bt] = gcdext(big_integer(to_std_string(a)), big_integer(to_std_string(b)));
+  EXPECT_EQ(to_std_string(g), to_string(bg));
+  EXPECT_EQ(to_std_string(s), to_string(bs));
+  EXPECT_EQ(to_std_string(t), to_string(bt));
+  mpz_clears(g, s, t, nullptr);
+}
+} // namespace
+
+TEST(gcd, fibonacci) {
+  // consecutive Fibonacci numbers have all quotients 1, gcd(F(m), F(n)) = F(gcd(m, n))
+  std::vector<big_integer> fib = {0, 1};
+  for (size_t i = 2; i <= 30000; i++) {
+    fib.push_back(fib[i - 1] + fib[i - 2]);
+  }
+  EXPECT_EQ(gcd(fib[30000], fib[29999]), 1);
+  EXPECT_EQ(gcd(fib[30000], fib[20000]), fib[10000]);
+  auto [g, s, t] = gcdext(fib[30000], fib[29999]);
+  EXPECT_EQ(g, 1);
+  EXPECT_EQ(s, fib[29997]);
+  EXPECT_EQ(t, -fib[29998]);
+
+  big_integer c = fib[12345] * 7;
+  big_integer a = fib[25000] * c + 1;
+  big_integer b = -(fib[22222] + 3) * c;
+  std::tie(g, s, t) = gcdext(a * c, b);
+  EXPECT_EQ(g % c, 0);
+  EXPECT_EQ(g, gcd(a * c, b));
+  EXPECT_EQ(a * c * s + b * t, g);
+  EXPECT_LE((s < 0 ? -s : s) * g * 2, -b);
+  EXPECT_LE((t < 0 ? -t : t) * g * 2, a * c);
+
+  big_integer m = fib[29999];
+  EXPECT_EQ(invert(fib[30000], m) * fib[30000] % m, 1);
+}
+
+TEST(gcd, against_gmp) {
+  gmp_randstate_t state;
+  gmp_randinit_mt(state);
+  gmp_randseed_ui(state, 20240101);
+  mpz_t a, b, c;
+  mpz_inits(a, b, c, nullptr);
+  for (size_t bits : {10000, 40000, 200000}) {
+    for (int i = 0; i < 4; i++) {
+      // every other pair shares a long factor, which ends the remainder
+      // sequence inside the half-gcd
+      mpz_urandomb(a, state, bits);
+      mpz_rrandomb(b, state, bits - 100 * i);
+      if (i % 2 == 1) {
+        mpz_urandomb(c, state, bits / 3);
+        mpz_mul(a, a, c);
+        mpz_mul(b, b, c);
+      }
+      check_gcdext(a, b);
+      check_gcdext(b, a);
+    }
+  }
+  mpz_clears(a, b, c, nullptr);
+  gmp_randclear(state);
+}
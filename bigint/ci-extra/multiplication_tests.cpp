@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include <gmp.h>
+#include <memory>
+#include <string>
+
+#include "../big_integer.h"
+
+namespace {
+struct gmp_random {
+  gmp_random() {
+    gmp_randinit_mt(state);
+    gmp_randseed_ui(state, 20240101);
+  }
+
+  ~gmp_random() {
+    gmp_randclear(state);
+  }
+
+  // random number of exactly `limbs` 32-bit limbs, every other one is
+  // built from long runs of zero and one bits to stress carry handling
+  std::string next(size_t limbs, bool negative) {
+    mpz_t x;
+    mpz_init(x);
+    if (counter++ % 2 == 0) {
+      mpz_urandomb(x, state, limbs * 32);
+    } else {
+      mpz_rrandomb(x, state, limbs * 32);
+    }
+    mpz_setbit(x, limbs * 32 - 1);
+    if (negative) {
+      mpz_neg(x, x);
+    }
+    std::string res = to_std_string(x);
+    mpz_clear(x);
+    return res;
+  }
+
+  static std::string to_std_string(mpz_t const x) {
+    std::unique_ptr<char, void (*)(void*)> str(mpz_get_str(nullptr, 10, x), free);
+    return str.get();
+  }
+
+  gmp_randstate_t state;
+  size_t counter = 0;
+};
+
+std::string gmp_mul(std::string const& a, std::string const& b) {
+  mpz_t x, y;
+  mpz_init_set_str(x, a.c_str(), 10);
+  mpz_init_set_str(y, b.c_str(), 10);
+  mpz_mul(x, x, y);
+  std::string res = gmp_random::to_std_string(x);
+  mpz_clears(x, y, nullptr);
+  return res;
+}
+
+void check_mul(gmp_random& rnd, size_t an, size_t bn) {
+  std::string a = rnd.next(an, an % 2 == 0);
+  std::string b = rnd.next(bn, bn % 3 == 0);
+  EXPECT_EQ(gmp_mul(a, b), to_string(big_integer(a) * big_integer(b)))
+      << an << " x " << bn << " limbs";
+}
+} // namespace
+
+TEST(multiplication, balanced_tiers) {
+  gmp_random rnd;
+  // schoolbook, Karatsuba, Toom-3, Toom-4 and the borders between them
+  for (size_t n : {1, 2, 31, 32, 33, 100, 199, 200, 201, 401, 599, 600, 601, 1500, 3001}) {
+    check_mul(rnd, n, n);
+    check_mul(rnd, n, n - n / 7);
+  }
+}
+
+TEST(multiplication, ntt) {
+  if (ntt_threshold() == 0) {
+    GTEST_SKIP() << "no NTT without 128-bit integers";
+  }
+  gmp_random rnd;
+  // around the NTT threshold of this build, counted in 32-bit limbs
+  size_t t = ntt_threshold() * (sizeof(limb_t) / 4);
+  for (size_t n : {t - 2, t, t + 2, t + t / 4, 2 * t - 1}) {
+    check_mul(rnd, n, n);
+  }
+  check_mul(rnd, t, 4 * t);
+  check_mul(rnd, t + 2, 3 * t + 7);
+}
+
+TEST(multiplication, unbalanced) {
+  gmp_random rnd;
+  for (size_t an : {64, 250, 700, 2500}) {
+    for (size_t bn : {1, 5, 40, 90, 200, 333, 650}) {
+      if (bn <= an) {
+        check_mul(rnd, an, bn);
+        check_mul(rnd, bn, an);
+      }
+    }
+  }
+}
+
+TEST(multiplication, randomized) {
+  gmp_random rnd;
+  for (size_t i = 0; i < 40; i++) {
+    size_t an = 1 + gmp_urandomm_ui(rnd.state, 2000);
+    size_t bn = 1 + gmp_urandomm_ui(rnd.state, 2000);
+    check_mul(rnd, an, bn);
+  }
+}
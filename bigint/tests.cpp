@@ -1,12 +1,40 @@
 #include "gtest/gtest.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
 #include <limits>
+#include <new>
+#include <random>
+#include <sstream>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "big_integer.h"
 
+// every allocation of the program is counted, for scratch_scope
+namespace {
+std::atomic<size_t> allocations(0);
+} // namespace
+
+void* operator new(size_t n) {
+  allocations++;
+  if (void* p = std::malloc(n != 0 ? n : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
 TEST(correctness, two_plus_two) {
   EXPECT_EQ(big_integer(4), big_integer(2) + big_integer(2));
   EXPECT_EQ(4, big_integer(2) + 2); // implicit conversion from int must work
@@ -76,6 +104,36 @@ TEST(correctness, self_assignment) {
   EXPECT_TRUE(a == 5);
 }
 
+TEST(correctness, move_ctor_and_assignment) {
+  big_integer a("123456789012345678901234567890");
+  big_integer b = std::move(a);
+  EXPECT_EQ(b, big_integer("123456789012345678901234567890"));
+  EXPECT_EQ(a, 0);
+
+  a = -b;
+  b = std::move(a);
+  EXPECT_EQ(b, big_integer("-123456789012345678901234567890"));
+  EXPECT_EQ(a, 0);
+  b = std::move(b);
+  EXPECT_EQ(b, big_integer("-123456789012345678901234567890"));
+}
+
+TEST(correctness, rvalue_operands) {
+  big_integer a("100000000000000000000000000007");
+  big_integer b("-3000000000000000000000");
+  big_integer c = 12345;
+
+  EXPECT_EQ(a + b + c + a, big_integer("199999997000000000000000012359"));
+  EXPECT_EQ(c - (a + b), big_integer("-99999996999999999999999987662"));
+  EXPECT_EQ((a - b) - (b - a), 2 * (a - b));
+  EXPECT_EQ(c * (a * b), big_integer("-3703500000000000000000000000259245000000000000000000000"));
+  EXPECT_EQ((a * c) / c, a);
+  EXPECT_EQ((a + 5) % c, (a % c + 5) % c);
+  EXPECT_EQ(c & (a ^ b), (a ^ b) & c);
+  EXPECT_EQ(-(a + b), -a - b);
+  EXPECT_EQ(+(a + b), a + b);
+}
+
 TEST(correctness, assignment_return_value) {
   big_integer a = 4;
   big_integer b = 7;
@@ -250,6 +308,37 @@ TEST(correctness, div_rounding_negative) {
   EXPECT_TRUE(c % d == -3);
 }
 
+TEST(correctness, divmod) {
+  auto [q, r] = divmod(-23, 5);
+  EXPECT_EQ(q, -4);
+  EXPECT_EQ(r, -3);
+
+  std::tie(q, r) = divmod_floor(-23, 5);
+  EXPECT_EQ(q, -5);
+  EXPECT_EQ(r, 2);
+  std::tie(q, r) = divmod_floor(23, -5);
+  EXPECT_EQ(q, -5);
+  EXPECT_EQ(r, -2);
+  std::tie(q, r) = divmod_floor(-20, 5);
+  EXPECT_EQ(q, -4);
+  EXPECT_EQ(r, 0);
+
+  big_integer a("-123456789012345678901234567890123456789012345678901234567890");
+  big_integer b("98765432109876543210987654321");
+  std::tie(q, r) = divmod(a, b);
+  EXPECT_EQ(q, a / b);
+  EXPECT_EQ(r, a % b);
+  std::tie(q, r) = divmod_floor(a, b);
+  EXPECT_EQ(q, a / b - 1);
+  EXPECT_EQ(r, a % b + b);
+  EXPECT_EQ(q * b + r, a);
+
+  std::tie(q, r) = divmod(b, a);
+  EXPECT_EQ(q, 0);
+  EXPECT_EQ(r, b);
+  EXPECT_THROW(divmod(a, 0), std::runtime_error);
+}
+
 TEST(correctness, div_return_value) {
   big_integer a = 100;
   big_integer b = 2;
@@ -300,6 +389,43 @@ TEST(correctness, decrement) {
   EXPECT_EQ(41, post);
 }
 
+TEST(correctness, increment_decrement_carry) {
+  big_integer a("340282366920938463463374607431768211455"); // 2^128 - 1
+  ++a;
+  EXPECT_EQ(a, big_integer("340282366920938463463374607431768211456"));
+  --a;
+  EXPECT_EQ(a, big_integer("340282366920938463463374607431768211455"));
+
+  big_integer b = -1;
+  ++b;
+  EXPECT_EQ(b, 0);
+  EXPECT_EQ(to_string(b), "0");
+  --b;
+  --b;
+  EXPECT_EQ(b, -2);
+  b = -a;
+  --b;
+  EXPECT_EQ(b, big_integer("-340282366920938463463374607431768211456"));
+  ++b;
+  EXPECT_EQ(b, -a);
+}
+
+TEST(correctness, inline_and_heap_storage) {
+  big_integer small = std::numeric_limits<long long>::min();
+  big_integer big = small * small * small;
+
+  big_integer a = small;
+  a = big;
+  EXPECT_EQ(a, big);
+  a = small;
+  EXPECT_EQ(a, small);
+
+  big_integer b = std::move(big);
+  big = std::move(a);
+  EXPECT_EQ(big, small);
+  EXPECT_EQ(b / small / small, small);
+}
+
 TEST(correctness, and_) {
   big_integer a = 0x55;
   big_integer b = 0xaa;
@@ -403,6 +529,50 @@ TEST(correctness, not_) {
   EXPECT_TRUE(~a == (-a - 1));
 }
 
+TEST(correctness, bitwise_long_signed) {
+  big_integer p = big_integer(1) << 200;
+  big_integer q = (big_integer(1) << 130) + 5;
+
+  EXPECT_EQ(-p & -q, -p);
+  EXPECT_EQ(-q & (p - 1), p - q);
+  EXPECT_EQ(-p | q, -p + q);
+  EXPECT_EQ(-p ^ -p, 0);
+  EXPECT_EQ((-p ^ (p - 1)), -1);
+  EXPECT_EQ(-p & (p - 1), 0);
+  EXPECT_EQ(andnot(p + q, q), p);
+  EXPECT_EQ(andnot(-p, q), -p);
+  EXPECT_EQ(andnot(-q, p), -q - p);
+  EXPECT_EQ(andnot(q, -1), 0);
+  EXPECT_EQ(andnot(-1, q), ~q);
+}
+
+TEST(correctness, single_bits) {
+  big_integer a = -(big_integer(1) << 100);
+
+  EXPECT_FALSE(a.test_bit(0));
+  EXPECT_FALSE(a.test_bit(99));
+  EXPECT_TRUE(a.test_bit(100));
+  EXPECT_TRUE(a.test_bit(1000));
+  EXPECT_TRUE(big_integer(-3).test_bit(0));
+  EXPECT_FALSE(big_integer(-3).test_bit(1));
+  EXPECT_FALSE(big_integer(5).test_bit(64));
+
+  EXPECT_EQ(big_integer(0).set_bit(100), big_integer(1) << 100);
+  EXPECT_EQ(big_integer(a).set_bit(0), a + 1);
+  EXPECT_EQ(big_integer(a).clear_bit(100), a - (big_integer(1) << 100));
+  EXPECT_EQ(big_integer(-1).clear_bit(0), -2);
+  EXPECT_EQ(big_integer(-2).set_bit(0), -1);
+  EXPECT_EQ(big_integer(6).clear_bit(1).clear_bit(2), 0);
+  EXPECT_EQ(big_integer(6).clear_bit(0), 6);
+
+  EXPECT_EQ(big_integer(0).bit_length(), 0u);
+  EXPECT_EQ(a.bit_length(), 101u);
+  EXPECT_EQ((-a - 1).bit_length(), 100u);
+  EXPECT_EQ((-a - 1).popcount(), 100u);
+  EXPECT_EQ(big_integer(0).popcount(), 0u);
+  EXPECT_EQ(a.popcount(), SIZE_MAX);
+}
+
 TEST(correctness, shl_) {
   big_integer a = 23;
 
@@ -465,6 +635,85 @@ TEST(correctness, add_long) {
   EXPECT_EQ(c, a + b);
 }
 
+TEST(correctness, add_sub_long_carry_chains) {
+  // carries and borrows rippling through runs of all-ones and zero limbs,
+  // across and inside the blocks handled by the vectorized kernels
+  for (int bits = 1; bits <= 2200; bits += 37) {
+    big_integer power = big_integer(1) << bits;
+    big_integer ones = power - 1;
+    EXPECT_EQ(ones + 1, power);
+    EXPECT_EQ(1 + ones, power);
+    EXPECT_EQ(power - 1 - ones, 0);
+
+    big_integer x = ones + (ones << (bits / 2));
+    EXPECT_EQ(x - (ones << (bits / 2)), ones);
+    EXPECT_EQ(x - ones - 1 + 1, ones << (bits / 2));
+    EXPECT_EQ(-x + ones, -(ones << (bits / 2)));
+  }
+}
+
+TEST(correctness, limb_kernels) {
+  // every kernel the CPU supports against the scalar one, on carry and
+  // borrow chains and on shifts, for lengths around the vector widths
+  std::mt19937_64 rng(12345);
+  limb_t const max = ~(limb_t) 0;
+  limb_kernels const& ref = limb_kernel(0);
+  std::vector<size_t> lengths;
+  for (size_t n = 1; n <= 70; n++) {
+    lengths.push_back(n);
+  }
+  lengths.insert(lengths.end(), {127, 128, 129, 255});
+
+  for (size_t k = 1; k < limb_kernel_count(); k++) {
+    limb_kernels const& cur = limb_kernel(k);
+    SCOPED_TRACE(cur.name);
+    for (size_t n : lengths) {
+      SCOPED_TRACE(n);
+      for (int pattern = 0; pattern < 3; pattern++) {
+        std::vector<limb_t> a(n), b(n);
+        for (size_t i = 0; i < n; i++) {
+          limb_t const special[] = {0, 1, max - 1, max, (limb_t) rng()};
+          a[i] = (pattern == 0 ? (limb_t) rng() : pattern == 1 ? max : special[rng() % 5]);
+          b[i] = (pattern == 0 ? (limb_t) rng() : pattern == 1 ? (i == 0) : special[rng() % 5]);
+        }
+        for (limb_t carry : {0, 1}) {
+          std::vector<limb_t> expected(n), got(n), in_place = a;
+          EXPECT_EQ(ref.add_n(expected.data(), a.data(), b.data(), n, carry),
+                    cur.add_n(got.data(), a.data(), b.data(), n, carry));
+          EXPECT_EQ(expected, got);
+          cur.add_n(in_place.data(), in_place.data(), b.data(), n, carry);
+          EXPECT_EQ(expected, in_place);
+
+          // a borrow chain needs zeros where the carry chain had all ones
+          std::vector<limb_t> c(n);
+          std::transform(a.begin(), a.end(), c.begin(), [](limb_t x) { return ~x; });
+          in_place = c;
+          EXPECT_EQ(ref.sub_n(expected.data(), c.data(), b.data(), n, carry),
+                    cur.sub_n(got.data(), c.data(), b.data(), n, carry));
+          EXPECT_EQ(expected, got);
+          cur.sub_n(in_place.data(), in_place.data(), b.data(), n, carry);
+          EXPECT_EQ(expected, in_place);
+        }
+        for (int bits : {1, 7, 8 * (int) sizeof(limb_t) / 2, 8 * (int) sizeof(limb_t) - 1}) {
+          std::vector<limb_t> expected(n), got(n), in_place = a;
+          EXPECT_EQ(ref.lshift(expected.data(), a.data(), n, bits),
+                    cur.lshift(got.data(), a.data(), n, bits));
+          EXPECT_EQ(expected, got);
+          cur.lshift(in_place.data(), in_place.data(), n, bits);
+          EXPECT_EQ(expected, in_place);
+
+          in_place = a;
+          EXPECT_EQ(ref.rshift(expected.data(), a.data(), n, bits),
+                    cur.rshift(got.data(), a.data(), n, bits));
+          EXPECT_EQ(expected, got);
+          cur.rshift(in_place.data(), in_place.data(), n, bits);
+          EXPECT_EQ(expected, in_place);
+        }
+      }
+    }
+  }
+}
+
 TEST(correctness, add_long_signed) {
   big_integer a("-1000000000000000000000000000000000000000000000000000000000000"
                 "000000000000000000000000000000");
@@ -551,6 +800,147 @@ TEST(correctness, mul_long_pow2) {
   EXPECT_EQ(c, b * b);
 }
 
+namespace {
+big_integer pow10(size_t n) {
+  return big_integer("1" + std::string(n, '0'));
+}
+} // namespace
+
+TEST(correctness, mul_karatsuba) {
+  // (10^n - 1)^2 = 10^2n - 2 * 10^n + 1
+  big_integer a(std::string(3000, '9'));
+  big_integer c(std::string(2999, '9') + "8" + std::string(2999, '0') + "1");
+
+  EXPECT_EQ(c, a * a);
+  EXPECT_EQ(c, a * (-a) * -1);
+  EXPECT_EQ(pow10(6000), a * a + 2 * a + 1);
+}
+
+TEST(correctness, mul_karatsuba_unbalanced) {
+  big_integer a(std::string(5000, '7'));
+  big_integer b(std::string(700, '3'));
+  big_integer c = pow10(1200) + 12345;
+
+  EXPECT_EQ(a * b + a * c, a * (b + c));
+  EXPECT_EQ(b * a - c * a, (b - c) * a);
+  EXPECT_EQ(a * b * c, c * (b * a));
+}
+
+TEST(correctness, mul_toom) {
+  big_integer a(std::string(25000, '9'));
+  big_integer b = pow10(15000) + 1;
+  big_integer c(std::string(20000, '3'));
+
+  EXPECT_EQ(pow10(40000) + pow10(25000) - b, a * b);
+  EXPECT_EQ(a * b + a * c, a * (b + c));
+  EXPECT_EQ((a + c) * (a - c), a * a - c * c);
+}
+
+// just above the NTT threshold, so both operands of the products below reach it
+static const int NTT_BITS = 8 * (int) (sizeof(limb_t) * ntt_threshold()) + 100;
+
+TEST(correctness, mul_ntt) {
+  if (ntt_threshold() == 0) {
+    GTEST_SKIP() << "no NTT without 128-bit integers";
+  }
+  big_integer a = (big_integer(1) << NTT_BITS) - 1;
+  big_integer b = ((big_integer(1) << (NTT_BITS - 50)) - 1) / 3;
+
+  EXPECT_EQ(((big_integer(1) << NTT_BITS) - 2 << NTT_BITS) + 1, a * a);
+  EXPECT_EQ((b << NTT_BITS) - b, a * b);
+}
+
+TEST(correctness, mul_threads) {
+  if (ntt_threshold() == 0) {
+    GTEST_SKIP() << "no NTT without 128-bit integers";
+  }
+  big_integer a = (big_integer(1) << NTT_BITS) - 1;
+  big_integer b = ((big_integer(1) << (NTT_BITS - 50)) - 1) / 7;
+
+  set_mul_threads(3, 1000);
+  EXPECT_EQ((b << NTT_BITS) - b, a * b);
+  EXPECT_EQ(((big_integer(1) << NTT_BITS) - 2 << NTT_BITS) + 1, sqr(a));
+  set_mul_threads(1);
+}
+
+TEST(correctness, scratch_scope) {
+  big_integer a = (big_integer(1) << 7000) / 3;
+  big_integer b = (big_integer(1) << 3100) / 7 + 1;
+  big_integer m = (big_integer(1) << 2000) - 1;
+  big_integer c, q, r;
+  auto round = [&] {
+    c = a * b;
+    q = c / b;
+    r = c % m;
+    r += q;
+    r -= a;
+    r = (r << 77) >> 13;
+    r = (r & a) | (b ^ -m);
+    r *= -c;
+    q = sqr(a) / -b;
+  };
+
+  // values kept across rounds need one more buffer in the second round
+  scratch_scope scope;
+  round();
+  round();
+  size_t before = allocations;
+  for (int i = 0; i < 5; i++) {
+    round();
+  }
+  EXPECT_EQ(allocations, before);
+  EXPECT_EQ(q, -(a * a / b));
+  EXPECT_EQ(c / b, a);
+
+  // small values are converted without any allocation
+  std::ostringstream out;
+  out << big_integer(12345);
+  std::string s = to_string(big_integer(-987654321));
+  before = allocations;
+  for (int i = 0; i < 5; i++) {
+    out.seekp(0);
+    out << big_integer(12345);
+    s = to_string(big_integer(-987654321));
+    r = big_integer("123");
+  }
+  EXPECT_EQ(allocations, before);
+  EXPECT_EQ(out.str(), "12345");
+  EXPECT_EQ(s, "-987654321");
+  EXPECT_EQ(r, 123);
+}
+
+TEST(correctness, scratch_scope_capacity) {
+  // capacities are only rounded up to a power of two inside a scope
+  limb_vector a(1000);
+  EXPECT_EQ(1000, a.capacity());
+  a.reserve(1500);
+  EXPECT_EQ(1500, a.capacity());
+  {
+    scratch_scope scope;
+    limb_vector b(1000);
+    EXPECT_EQ(1024, b.capacity());
+    a = limb_vector(700);
+  }
+  EXPECT_EQ(1024, a.capacity());
+  limb_vector c(1000);
+  EXPECT_EQ(1000, c.capacity());
+}
+
+TEST(correctness, sqr) {
+  EXPECT_EQ(0, sqr(big_integer()));
+  EXPECT_EQ(49, sqr(big_integer(-7)));
+
+  for (size_t n : {20, 500, 3000, 9000}) {
+    big_integer a(std::string(n, '9'));
+    big_integer b = pow10(2 * n) - 2 * pow10(n) + 1;
+    EXPECT_EQ(b, sqr(a));
+    EXPECT_EQ(b, sqr(-a));
+    EXPECT_EQ(sqr(a + 1) - 2 * a - 1, a * a);
+    a *= a;
+    EXPECT_EQ(b, a);
+  }
+}
+
 TEST(correctness, div_long) {
   big_integer a("10000000000000000000000000000000000000000000000000000000000000"
                 "000000000000000000000000000000");
@@ -578,6 +968,266 @@ TEST(correctness, div_long_signed2) {
   EXPECT_EQ(c, a / b);
 }
 
+TEST(correctness, div_long_max_limb) {
+  big_integer a("340282366920938463463374607431768211455"); // (1 << 128) - 1
+  big_integer b("18446744073709551615");                    // (1 << 64) - 1
+
+  EXPECT_EQ(big_integer("18446744073709551617"), a / b);
+  EXPECT_EQ(0, a % b);
+  EXPECT_EQ(b - 1, (a - 1) % b);
+}
+
+TEST(correctness, div_long_allocations) {
+  // a divisor below the Burnikel-Ziegler threshold, the top limbs all ones
+  // to exercise the correction of the quotient estimate
+  big_integer b = ((big_integer(1) << 1250) - 1 << 30) + 12345;
+  size_t counts[2];
+  for (int i = 0; i < 2; i++) {
+    big_integer a = ((big_integer(1) << (i == 0 ? 3000 : 60000)) - 1) / 3;
+    size_t before = allocations;
+    auto [q, r] = divmod(a, b);
+    counts[i] = allocations - before;
+    EXPECT_EQ(q * b + r, a);
+    EXPECT_TRUE(r >= 0 && r < b);
+  }
+  EXPECT_EQ(counts[0], counts[1]);
+}
+
+TEST(correctness, div_burnikel_ziegler) {
+  big_integer a(std::string(3000, '9'));
+  big_integer b = pow10(1200) + 7;
+
+  EXPECT_EQ(pow10(1700) - 1, sqr(pow10(1700)) / (pow10(1700) + 1));
+  EXPECT_EQ(a, (a * b) / b);
+  EXPECT_EQ(b - 1, (a * b + b - 1) % b);
+
+  for (big_integer const& c : {a, -a, a * a + 12345, -(a * b * b)}) {
+    for (big_integer const& d : {b, -b, b * b - 1}) {
+      big_integer q = c / d;
+      big_integer r = c % d;
+      EXPECT_EQ(c, q * d + r);
+      EXPECT_TRUE((r < 0 ? -r : r) < (d < 0 ? -d : d));
+      EXPECT_TRUE(r == 0 || (r < 0) == (c < 0));
+    }
+  }
+}
+
+TEST(correctness, div_reciprocal) {
+  big_integer a = -(sqr(pow10(3000)) + 123456789);
+  for (big_integer const& d : {big_integer(7), big_integer(-1), pow10(20) - 1,
+                               -pow10(1000) - 3, sqr(pow10(1000)) + 1}) {
+    big_reciprocal inv = d.reciprocal();
+    EXPECT_EQ(d, inv.divisor());
+    for (big_integer const& c : {big_integer(0), big_integer(5), a, -a, d, a * d - 1}) {
+      EXPECT_EQ(c / d, c / inv);
+      EXPECT_EQ(c % d, c % inv);
+    }
+  }
+  big_integer b = a;
+  b /= pow10(10).reciprocal();
+  EXPECT_EQ(a / pow10(10), b);
+  EXPECT_THROW(big_integer().reciprocal(), std::runtime_error);
+}
+
+TEST(correctness, barrett_reducer) {
+  big_integer m = (big_integer(1) << 300) - 153;
+  barrett_reducer red(m);
+
+  EXPECT_EQ(red.modulus(), m);
+  for (big_integer const& x : {big_integer(0), big_integer(5), m - 1, m, m + 1, 2 * m + 7,
+                               m * m - 1, (m - 1) * (m - 1), big_integer(1) << 600}) {
+    EXPECT_EQ(x % red, x % m);
+    EXPECT_EQ(-x % red, -x % m);
+  }
+  big_integer a = m * m * m + 12345;
+  a %= red;
+  EXPECT_EQ(a, 12345);
+
+  barrett_reducer red_neg(-m);
+  EXPECT_EQ((m * 3 + 2) % red_neg, 2);
+  EXPECT_EQ(big_integer(100) % barrett_reducer(7), 2);
+  EXPECT_THROW(barrett_reducer(0), std::runtime_error);
+
+  // long moduli go through the short products, all-ones limbs make the
+  // dropped columns as large as they can be
+  std::mt19937_64 rng(7);
+  auto random_number = [&](size_t words) {
+    big_integer r = 0;
+    for (size_t i = 0; i < words; i++) {
+      r = (r << 32) + (unsigned) rng();
+    }
+    return r;
+  };
+  for (size_t bits : {2048, 5000, 8192}) {
+    big_integer ones = (big_integer(1) << bits) - 1;
+    for (big_integer const& mod : {ones, ones + 2, ones >> 1, big_integer(1) << (bits - 64),
+                                   random_number(bits / 32)}) {
+      barrett_reducer r(mod);
+      for (big_integer const& x : {(mod - 1) * (mod - 1), mod * mod - 1, ones * ones,
+                                   random_number(bits / 16), random_number(bits / 16 - 3)}) {
+        EXPECT_EQ(x % r, x % mod);
+      }
+    }
+  }
+}
+
+TEST(correctness, powmod) {
+  big_integer p = (big_integer(1) << 127) - 1;
+  big_integer q = (big_integer(1) << 521) - 1;
+
+  EXPECT_EQ(powmod(3, p - 1, p), 1);
+  EXPECT_EQ(powmod(-5, q - 1, q), 1);
+  EXPECT_EQ(powmod(2, 127, p), 1);
+  EXPECT_EQ(powmod(-2, 3, 7), 6);
+  EXPECT_EQ(powmod(2, 100, -1000000007), 976371285);
+  EXPECT_EQ(powmod(3, 1000, big_integer(1) << 64), big_integer("6203307696791771937"));
+  EXPECT_EQ(powmod(7, 0, 13), 1);
+  EXPECT_EQ(powmod(7, 0, 1), 0);
+  EXPECT_EQ(powmod(0, 5, 13), 0);
+  EXPECT_THROW(powmod(2, -1, 13), std::invalid_argument);
+  EXPECT_THROW(powmod(2, 1, 0), std::runtime_error);
+
+  montgomery_context ctx(q);
+  big_integer e = (q - 1) / 2;
+  EXPECT_EQ(ctx.pow(4, e), 1);
+  EXPECT_EQ(ctx.pow(p * p, e), 1);
+  EXPECT_EQ(ctx.pow(-4, e), q - 1);
+  EXPECT_EQ(ctx.pow(q + 10, 3), 1000);
+  EXPECT_THROW(montgomery_context(big_integer(1) << 100), std::invalid_argument);
+}
+
+TEST(correctness, gcd) {
+  EXPECT_EQ(gcd(12, 18), 6);
+  EXPECT_EQ(gcd(-12, 18), 6);
+  EXPECT_EQ(gcd(12, -18), 6);
+  EXPECT_EQ(gcd(0, -7), 7);
+  EXPECT_EQ(gcd(0, 0), 0);
+
+  auto [g, s, t] = gcdext(240, 46);
+  EXPECT_EQ(g, 2);
+  EXPECT_EQ(s, -9);
+  EXPECT_EQ(t, 47);
+  std::tie(g, s, t) = gcdext(-240, 46);
+  EXPECT_EQ(s, 9);
+  EXPECT_EQ(t, 47);
+  std::tie(g, s, t) = gcdext(5, 5);
+  EXPECT_EQ(s, 0);
+  EXPECT_EQ(t, 1);
+  std::tie(g, s, t) = gcdext(-5, 0);
+  EXPECT_EQ(g, 5);
+  EXPECT_EQ(s, -1);
+  EXPECT_EQ(t, 0);
+
+  EXPECT_EQ(invert(3, 7), 5);
+  EXPECT_EQ(invert(-3, 7), 2);
+  EXPECT_EQ(invert(3, -7), 5);
+  EXPECT_THROW(invert(6, 9), std::invalid_argument);
+  EXPECT_THROW(invert(3, 0), std::runtime_error);
+
+  // consecutive Fibonacci numbers have all quotients 1, gcd(F(m), F(n)) = F(gcd(m, n)),
+  // ci-extra/gcd_tests.cpp has long ones for the half-gcd
+  std::vector<big_integer> fib = {0, 1};
+  for (size_t i = 2; i <= 300; i++) {
+    fib.push_back(fib[i - 1] + fib[i - 2]);
+  }
+  EXPECT_EQ(gcd(fib[300], fib[299]), 1);
+  EXPECT_EQ(gcd(fib[300], fib[200]), fib[100]);
+  std::tie(g, s, t) = gcdext(fib[300], fib[299]);
+  EXPECT_EQ(g, 1);
+  EXPECT_EQ(s, fib[297]);
+  EXPECT_EQ(t, -fib[298]);
+
+  big_integer c = fib[123] * 7;
+  big_integer a = fib[250] * c + 1;
+  big_integer b = -(fib[222] + 3) * c;
+  std::tie(g, s, t) = gcdext(a * c, b);
+  EXPECT_EQ(g % c, 0);
+  EXPECT_EQ(g, gcd(a * c, b));
+  EXPECT_EQ(a * c * s + b * t, g);
+  EXPECT_LE((s < 0 ? -s : s) * g * 2, -b);
+  EXPECT_LE((t < 0 ? -t : t) * g * 2, a * c);
+
+  // a long common factor ends the remainder sequence inside the half-gcd
+  std::mt19937_64 rng(1);
+  auto random_number = [&](size_t words) {
+    big_integer r = 0;
+    for (size_t i = 0; i < words; i++) {
+      r = (r << 32) + (unsigned) rng();
+    }
+    return r;
+  };
+  for (size_t i = 0; i < 4; i++) {
+    c = random_number(300);
+    a = random_number(500);
+    b = random_number(490);
+    std::tie(g, s, t) = gcdext(a * c, b * c);
+    EXPECT_EQ(g, gcd(a, b) * c);
+    EXPECT_EQ(a * c * s + b * c * t, g);
+  }
+
+  big_integer m = fib[299];
+  EXPECT_EQ(invert(fib[300], m) * fib[300] % m, 1);
+}
+
+TEST(correctness, roots) {
+  EXPECT_EQ(isqrt(0), 0);
+  EXPECT_EQ(isqrt(1), 1);
+  EXPECT_EQ(isqrt(99), 9);
+  EXPECT_EQ(isqrt(100), 10);
+  EXPECT_EQ(iroot(27, 3), 3);
+  EXPECT_EQ(iroot(26, 3), 2);
+  EXPECT_EQ(iroot(-27, 3), -3);
+  EXPECT_EQ(iroot(-26, 3), -2);
+  EXPECT_EQ(iroot(1000, 1), 1000);
+  EXPECT_EQ(iroot(1000, 100), 1);
+  EXPECT_THROW(isqrt(-1), std::invalid_argument);
+  EXPECT_THROW(iroot(-16, 4), std::invalid_argument);
+  EXPECT_THROW(iroot(16, 0), std::invalid_argument);
+
+  big_integer x("123456789012345678901234567890123456789012345678901234567890");
+  x = x * x * x + 12345;
+  big_integer s = x * x;
+  EXPECT_EQ(isqrt(s), x);
+  EXPECT_EQ(isqrt(s - 1), x - 1);
+  EXPECT_EQ(isqrt(s + 2 * x), x);
+  EXPECT_EQ(iroot(s, 2), x);
+
+  big_integer p = x * x * x * x * x;
+  EXPECT_EQ(iroot(p, 5), x);
+  EXPECT_EQ(iroot(p - 1, 5), x - 1);
+  EXPECT_EQ(iroot(-p, 5), -x);
+  EXPECT_EQ(iroot(p * p * p, 15), x);
+  EXPECT_EQ(iroot(p, 1000), 7);
+}
+
+TEST(correctness, import_export) {
+  unsigned char be[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+  big_integer a = import_words(be, 9, 1, 1, 0);
+  EXPECT_EQ(a, big_integer("18591708106338011145"));
+  EXPECT_EQ(import_words(be, 3, -1, 3, 1), big_integer("129706206962682757635"));
+  EXPECT_EQ(import_words(be, 0, 1, 4, 0), 0);
+
+  std::vector<unsigned char> out(16, 0xff);
+  EXPECT_EQ(export_words(out.data(), -a, 1, 4, 1), 3u);
+  unsigned char expected[] = {0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+  EXPECT_TRUE(std::equal(expected, expected + 12, out.begin()));
+  EXPECT_EQ(export_words(out.data(), a, -1, 2, -1), 5u);
+  EXPECT_EQ(out[0], 0x09);
+  EXPECT_EQ(out[1], 0x08);
+  EXPECT_EQ(out[8], 0x01);
+  EXPECT_EQ(out[9], 0x00);
+  EXPECT_EQ(export_words(out.data(), 0, 1, 8, 0), 0u);
+  EXPECT_THROW(export_words(out.data(), a, 0, 8, 0), std::invalid_argument);
+
+  big_integer b = -(big_integer(1) << 1000) + 12345;
+  limb_span view = b.limbs();
+  EXPECT_EQ(view.size(), 1000 / (8 * sizeof(limb_t)) + 1);
+  EXPECT_EQ(view[0], limb_t(0) - 12345);
+  EXPECT_TRUE(b.is_negative());
+  EXPECT_FALSE((b - b).is_negative());
+  EXPECT_EQ(-import_words(view.data(), view.size(), -1, sizeof(limb_t), 0), b);
+}
+
 TEST(correctness, negation_long) {
   big_integer a("10000000000000000000000000000000000000000000000000000");
   big_integer c("-10000000000000000000000000000000000000000000000000000");
@@ -627,6 +1277,34 @@ TEST(correctness, shr_long) {
           31);
 }
 
+TEST(correctness, shr_negative_rounding) {
+  big_integer p = big_integer(1) << 100;
+
+  EXPECT_EQ(-p >> 100, -1);
+  EXPECT_EQ(-p >> 99, -2);
+  EXPECT_EQ(-p >> 101, -1);
+  EXPECT_EQ((-p - 1) >> 100, -2);
+  EXPECT_EQ(-p >> 64, -(big_integer(1) << 36));
+  EXPECT_EQ(big_integer(-1) >> 1000, -1);
+  EXPECT_EQ(big_integer(-1) >> 0, -1);
+  EXPECT_EQ(p >> 101, 0);
+}
+
+TEST(correctness, shift_long_roundtrip) {
+  big_integer a = big_integer("-3417856182746231874623148723164812376512852437523846123876");
+  for (int i = 0; i < 5; i++) {
+    a = a * a * 12345 - 1;
+  }
+  for (int s : {1, 31, 32, 33, 63, 64, 65, 100, 1000, 4097}) {
+    big_integer b = a << s;
+    EXPECT_EQ(b, a * (big_integer(1) << s));
+    EXPECT_EQ(b >> s, a);
+    EXPECT_EQ((b + 1) >> s, a);
+    EXPECT_EQ((b - 1) >> s, a - 1);
+    EXPECT_EQ(-b >> s, -a);
+  }
+}
+
 TEST(correctness, string_conv) {
   EXPECT_EQ("100", to_string(big_integer("100")));
   EXPECT_EQ("100", to_string(big_integer("0100")));
@@ -644,6 +1322,44 @@ TEST(correctness, string_conv) {
   EXPECT_EQ("-2147483649", to_string(lim));
 }
 
+TEST(correctness, string_conv_long) {
+  for (size_t n : {9, 18, 100, 576, 577, 1151, 1152, 5000, 20000}) {
+    std::string nines(n, '9');
+    EXPECT_EQ(nines, to_string(big_integer(nines)));
+    EXPECT_EQ("-" + nines, to_string(-big_integer(nines)));
+    EXPECT_EQ("1" + std::string(n, '0'), to_string(big_integer(nines) + 1));
+    EXPECT_EQ("1" + std::string(n - 1, '0') + "1", to_string(big_integer(nines) + 2));
+  }
+  std::string digits;
+  for (size_t i = 0; i < 10000; i++) {
+    digits += (char) ('1' + i * 7 % 9);
+  }
+  EXPECT_EQ(digits, to_string(big_integer(digits)));
+  EXPECT_EQ("-" + digits, to_string(big_integer("-" + digits)));
+
+  // above the powers cached per thread
+  std::string many = digits + std::string(60000, '0') + digits;
+  EXPECT_EQ(many, to_string(big_integer(many)));
+  EXPECT_EQ("1" + std::string(80000, '0'), to_string(big_integer(std::string(80000, '9')) + 1));
+}
+
+TEST(correctness, string_ctor_long) {
+  std::string digits(30000, '0');
+  for (size_t i = 0; i < digits.size(); i++) {
+    digits[i] = (char) ('0' + (i * 7 + 3) % 10);
+  }
+  big_integer a(digits);
+  big_integer b(digits.substr(0, 12345));
+  big_integer c(digits.substr(12345));
+
+  EXPECT_EQ(a, b * pow10(digits.size() - 12345) + c);
+  EXPECT_EQ(-a, big_integer("-" + digits));
+  EXPECT_EQ(a, big_integer(std::string(5000, '0') + digits));
+  EXPECT_EQ(0, big_integer(std::string(5000, '0')));
+  EXPECT_THROW(big_integer(digits + "x"), std::invalid_argument);
+  EXPECT_THROW(big_integer("-" + digits + "-"), std::invalid_argument);
+}
+
 namespace {
 template <typename T>
 void test_converting_ctor(T value) {
@@ -654,6 +1370,62 @@ void test_converting_ctor(T value) {
 }
 } // namespace
 
+TEST(correctness, string_conv_radix) {
+  big_integer a("-3735928559");
+  EXPECT_EQ(to_string(a, 16), "-deadbeef");
+  EXPECT_EQ(to_string(a, 2), "-11011110101011011011111011101111");
+  EXPECT_EQ(to_string(a, 8), "-33653337357");
+  EXPECT_EQ(to_string(a, 32), "-3farfnf");
+  EXPECT_EQ(to_string(a, 10), "-3735928559");
+  EXPECT_EQ(to_string(0, 16), "0");
+  EXPECT_EQ(big_integer("-DeadBeef", 16), a);
+  EXPECT_EQ(big_integer("-0033653337357", 8), a);
+  EXPECT_EQ(big_integer("-3fARFNF", 32), a);
+  EXPECT_EQ(big_integer("-0", 2), 0);
+  EXPECT_THROW(big_integer("12", 3), std::invalid_argument);
+  EXPECT_THROW(to_string(a, 36), std::invalid_argument);
+  EXPECT_THROW(big_integer("128", 8), std::invalid_argument);
+  EXPECT_THROW(big_integer("-", 16), std::invalid_argument);
+
+  big_integer b = (big_integer(1) << 1000) - 1;
+  EXPECT_EQ(to_string(b, 16), "ff" + std::string(248, 'f'));
+  EXPECT_EQ(to_string(b, 32), std::string(200, 'v'));
+  EXPECT_EQ(to_string(b, 8), "1" + std::string(333, '7'));
+  for (int base : {2, 8, 16, 32, 10}) {
+    big_integer c = b * 12345678 + 987654321;
+    EXPECT_EQ(big_integer(to_string(c, base), base), c);
+    EXPECT_EQ(big_integer(to_string(-c, base), base), -c);
+  }
+}
+
+TEST(correctness, stream_io) {
+  std::istringstream in("  -00123 456\n-0 x");
+  big_integer a, b, c, d = 5;
+  in >> a >> b >> c;
+  EXPECT_EQ(a, -123);
+  EXPECT_EQ(b, 456);
+  EXPECT_EQ(c, 0);
+  EXPECT_TRUE(in.good());
+  in >> d;
+  EXPECT_TRUE(in.fail());
+  EXPECT_EQ(d, 5);
+
+  // several chunks of digits, with a partial one at the end
+  std::string digits;
+  for (size_t i = 0; i < 40000; i++) {
+    digits.push_back((char) ('0' + (i * 7 + i / 13) % 10));
+  }
+  std::istringstream long_in("-" + digits);
+  long_in >> a;
+  EXPECT_TRUE(long_in.eof());
+  EXPECT_FALSE(long_in.fail());
+  EXPECT_EQ(a, big_integer("-" + digits));
+
+  std::ostringstream out;
+  out << a << ' ' << (a - 1) / 2 << ' ' << big_integer(42);
+  EXPECT_EQ(out.str(), to_string(a) + ' ' + to_string((a - 1) / 2) + " 42");
+}
+
 TEST(correctness, converting_ctor) {
   using std::numeric_limits;
 